@@ -1,9 +1,20 @@
 #pragma once
 
 #include "./trollworks/assets.hpp"
+#include "./trollworks/pack.hpp"
+#include "./trollworks/watch.hpp"
 #include "./trollworks/coroutine.hpp"
+#include "./trollworks/world.hpp"
 #include "./trollworks/game-loop.hpp"
 #include "./trollworks/scene.hpp"
+#include "./trollworks/prefab.hpp"
+#include "./trollworks/snapshot.hpp"
+#include "./trollworks/streaming.hpp"
+#include "./trollworks/mirror.hpp"
+#include "./trollworks/rollback.hpp"
 #include "./trollworks/messaging.hpp"
+#include "./trollworks/arena.hpp"
 #include "./trollworks/jobs.hpp"
+#include "./trollworks/workers.hpp"
+#include "./trollworks/io.hpp"
 #include "./trollworks/ui.hpp"
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <memory_resource>
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace tw {
+  class frame_arena : public std::pmr::memory_resource {
+    private:
+      struct block {
+        std::byte* data;
+        std::size_t size;
+        std::size_t align;
+      };
+
+    public:
+      explicit frame_arena(
+        std::size_t block_size = 64 * 1024,
+        std::pmr::memory_resource* upstream = std::pmr::new_delete_resource()
+      ) : m_block_size(block_size), m_upstream(upstream) {}
+
+      frame_arena(const frame_arena&) = delete;
+      frame_arena& operator=(const frame_arena&) = delete;
+
+      ~frame_arena() override {
+        for (auto& b : m_blocks) {
+          m_upstream->deallocate(b.data, b.size, b.align);
+        }
+      }
+
+      void reset() {
+        m_current = 0;
+        m_offset = 0;
+      }
+
+      std::size_t capacity() const {
+        auto total = std::size_t{0};
+
+        for (auto& b : m_blocks) {
+          total += b.size;
+        }
+
+        return total;
+      }
+
+    private:
+      void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+        for (; m_current < m_blocks.size(); ++m_current, m_offset = 0) {
+          auto& b = m_blocks[m_current];
+          void* ptr = b.data + m_offset;
+          auto space = b.size - m_offset;
+
+          // the address is aligned, blocks may be less aligned than the request
+          if (std::align(alignment, bytes, ptr, space) != nullptr) {
+            m_offset = static_cast<std::size_t>(static_cast<std::byte*>(ptr) - b.data) + bytes;
+            return ptr;
+          }
+        }
+
+        auto align = std::max(alignment, alignof(std::max_align_t));
+        auto size = std::max(m_block_size, bytes);
+        auto* data = static_cast<std::byte*>(m_upstream->allocate(size, align));
+
+        m_blocks.push_back(block{.data = data, .size = size, .align = align});
+        m_current = m_blocks.size() - 1;
+        m_offset = bytes;
+        return data;
+      }
+
+      void do_deallocate(void*, std::size_t, std::size_t) override {}
+
+      bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+      }
+
+    private:
+      std::size_t m_block_size;
+      std::pmr::memory_resource* m_upstream;
+      std::vector<block> m_blocks;
+      std::size_t m_current{0};
+      std::size_t m_offset{0};
+  };
+}
@@ -1,10 +1,30 @@
 #pragma once
 
 #include <type_traits>
+#include <filesystem>
+#include <functional>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
 #include <concepts>
+#include <stdexcept>
+#include <optional>
+#include <utility>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <tuple>
+#include <mutex>
+#include <map>
 
 #include "../entt/entt.hpp"
 
+#include "./singleton.hpp"
+#include "./messaging.hpp"
+#include "./workers.hpp"
+#include "./watch.hpp"
+
 namespace tw {
   template <typename T>
   concept asset_trait = requires(T& asset) {
@@ -12,20 +32,881 @@ namespace tw {
     typename T::loader_type;
   };
 
+  struct asset_stats {
+    std::size_t budget{0};
+    std::size_t used{0};
+    std::size_t resident{0};
+    std::size_t evictions{0};
+    std::size_t evicted_bytes{0};
+  };
+
+  template <typename A>
+  concept sized_asset_trait = requires(const typename A::loader_type& loader, const typename A::resource_type& resource) {
+    { loader.size(resource) } -> std::convertible_to<std::size_t>;
+  };
+
+  class asset_queue {
+    public:
+      static asset_queue& main() {
+        return detail::singleton<asset_queue>();
+      }
+
+      void push(std::function<void()> completion) {
+        auto lock = std::scoped_lock{m_mutex};
+        m_completions.push_back(std::move(completion));
+      }
+
+      void submit(std::function<void()> load) {
+        m_in_flight.fetch_add(1, std::memory_order_relaxed);
+
+        worker_pool::main().submit([this, load = std::move(load)]() {
+          load();
+          m_in_flight.fetch_sub(1, std::memory_order_release);
+        });
+      }
+
+      std::size_t in_flight() const {
+        return m_in_flight.load(std::memory_order_acquire);
+      }
+
+      // resources read by loads on the worker pool, counted on the main thread
+      void pin(const void* resource) {
+        m_pins[resource]++;
+      }
+
+      void unpin(const void* resource) {
+        if (auto it = m_pins.find(resource); it != m_pins.end() && --it->second == 0) {
+          m_pins.erase(it);
+        }
+      }
+
+      bool pinned(const void* resource) const {
+        return m_pins.contains(resource);
+      }
+
+      std::size_t update() {
+        auto completions = std::vector<std::function<void()>>{};
+
+        {
+          auto lock = std::scoped_lock{m_mutex};
+          std::swap(completions, m_completions);
+        }
+
+        for (auto& completion : completions) {
+          completion();
+        }
+
+        for (auto collect : m_collectors) {
+          collect();
+        }
+
+        return completions.size();
+      }
+
+      void collect_with(std::size_t (*collect)()) {
+        if (std::ranges::find(m_collectors, collect) == m_collectors.end()) {
+          m_collectors.push_back(collect);
+        }
+      }
+
+    private:
+      std::mutex m_mutex;
+      std::vector<std::function<void()>> m_completions;
+      std::vector<std::size_t (*)()> m_collectors;
+      std::atomic<std::size_t> m_in_flight{0};
+      entt::dense_map<const void*, std::size_t> m_pins;
+  };
+
+  template <asset_trait A>
+  class asset_manager;
+
+  template <typename Resource>
+  class asset_handle {
+    private:
+      struct state {
+        entt::id_type id;
+        std::shared_ptr<Resource> value{nullptr};
+        std::exception_ptr exc{nullptr};
+        bool done{false};
+        std::vector<std::function<void()>> continuations;
+      };
+
+    public:
+      entt::id_type id() const {
+        return m_state->id;
+      }
+
+      bool ready() const {
+        return m_state->done && !m_state->exc;
+      }
+
+      bool failed() const {
+        return m_state->done && m_state->exc;
+      }
+
+      std::exception_ptr error() const {
+        return m_state->exc;
+      }
+
+      entt::resource<Resource> resource() const {
+        return entt::resource<Resource>{m_state->value};
+      }
+
+      void then(std::function<void()> continuation) const {
+        if (m_state->done) {
+          continuation();
+        }
+        else {
+          m_state->continuations.push_back(std::move(continuation));
+        }
+      }
+
+    private:
+      template <asset_trait A>
+      friend class asset_manager;
+
+      explicit asset_handle(entt::id_type id) : m_state(std::make_shared<state>(id)) {}
+      explicit asset_handle(std::shared_ptr<state> s) : m_state(std::move(s)) {}
+
+    private:
+      std::shared_ptr<state> m_state;
+  };
+
+  template <asset_trait A>
+  struct asset_loaded {
+    asset_handle<typename A::resource_type> handle;
+  };
+
+  template <asset_trait A>
+  struct asset_reloaded {
+    entt::id_type id;
+    std::exception_ptr error{nullptr};
+  };
+
   template <asset_trait A>
   class asset_manager {
+    private:
+      struct preloaded_t {};
+
+      template <typename T>
+      struct is_resource : std::false_type {};
+
+      template <typename T>
+      struct is_resource<entt::resource<T>> : std::true_type {};
+
+      // wraps the loader rather than deriving from it, loaders may be final
+      struct loader_adapter {
+        using result_type = typename A::loader_type::result_type;
+
+        template <typename... Args>
+        result_type operator()(Args&&... args) {
+          return asset_manager::loader()(std::forward<Args>(args)...);
+        }
+
+        result_type operator()(preloaded_t, result_type value) {
+          return value;
+        }
+      };
+
+      struct loader_instance {
+        typename A::loader_type loader;
+      };
+
+      struct pending_loads {
+        entt::dense_map<entt::id_type, asset_handle<typename A::resource_type>, entt::identity> handles;
+      };
+
+      struct watched {
+        std::size_t token;
+        std::function<typename A::loader_type::result_type()> load;
+        std::vector<const void*> pins;
+        std::optional<typename A::loader_type::result_type> deferred{std::nullopt};
+        bool loading{false};
+        bool stale{false};
+      };
+
+      struct watches {
+        entt::dense_map<entt::id_type, watched, entt::identity> entries;
+      };
+
+      struct accounting {
+        struct entry {
+          std::size_t size;
+          std::uint64_t last_used;
+          std::weak_ptr<typename A::resource_type> resource;
+        };
+
+        asset_stats stats;
+        std::uint64_t tick{0};
+        entt::dense_map<entt::id_type, entry, entt::identity> entries;
+      };
+
     public:
+      using handle_type = asset_handle<typename A::resource_type>;
+
       using cache_type = entt::resource_cache<
         typename A::resource_type,
-        typename A::loader_type
+        loader_adapter
       >;
 
       static cache_type& cache() {
-        if (!entt::locator<cache_type>::has_value()) {
-          entt::locator<cache_type>::emplace();
+        return detail::singleton<cache_type>();
+      }
+
+      // the cache, the worker pool and the file watcher share one loader
+      static typename A::loader_type& loader() {
+        return detail::singleton<loader_instance>().loader;
+      }
+
+      template <typename... Args>
+      static handle_type load_async(entt::id_type id, Args&&... args) {
+        auto& handles = pending().handles;
+
+        if (auto it = handles.find(id); it != handles.end()) {
+          return it->second;
+        }
+
+        auto handle = handle_type{id};
+
+        if (cache().contains(id)) {
+          handle.m_state->value = cache()[id].handle();
+          handle.m_state->done = true;
+          return handle;
+        }
+
+        handles.emplace(id, handle);
+
+        auto pins = pins_of(args...);
+
+        for (auto* resource : pins) {
+          asset_queue::main().pin(resource);
+        }
+
+        asset_queue::main().submit([state = handle.m_state, pins = std::move(pins), ...args = std::forward<Args>(args)]() mutable {
+          try {
+            state->value = loader()(std::move(args)...);
+          }
+          catch (...) {
+            state->exc = std::current_exception();
+          }
+
+          asset_queue::main().push([handle = handle_type{state}, pins = std::move(pins)]() {
+            for (auto* resource : pins) {
+              asset_queue::main().unpin(resource);
+            }
+
+            complete(handle);
+          });
+        });
+
+        return handle;
+      }
+
+      static bool loading(entt::id_type id) {
+        return pending().handles.contains(id);
+      }
+
+      static void with_budget(std::size_t bytes) {
+        budget().stats.budget = bytes;
+        asset_queue::main().collect_with(&asset_manager::collect);
+      }
+
+      static entt::resource<typename A::resource_type> get(entt::id_type id) {
+        auto res = cache()[id];
+
+        if (res) {
+          account(id, res.handle()).last_used = budget().tick;
+        }
+
+        return res;
+      }
+
+      template <typename... Args>
+      static entt::resource<typename A::resource_type> force_load(entt::id_type id, Args&&... args) {
+        auto [it, loaded] = cache().force_load(id, std::forward<Args>(args)...);
+        account(id, it->second.handle());
+        return it->second;
+      }
+
+      static std::size_t collect() {
+        auto& b = budget();
+        auto& c = cache();
+        b.tick++;
+
+        auto over = [&b]() {
+          return b.stats.budget > 0 && b.stats.used > b.stats.budget;
+        };
+
+        // resources loaded or erased through the cache directly change its size
+        if (c.size() != b.entries.size() || over()) {
+          refresh();
+        }
+
+        b.stats.resident = c.size();
+
+        if (!over()) {
+          return 0;
+        }
+
+        auto candidates = std::vector<std::pair<std::uint64_t, entt::id_type>>{};
+
+        for (auto [id, res] : c) {
+          auto& entry = b.entries.find(id)->second;
+
+          // an unused resource is only referenced by the cache and this copy
+          if (res.handle().use_count() > 2) {
+            entry.last_used = b.tick;
+          }
+          else {
+            candidates.emplace_back(entry.last_used, id);
+          }
+        }
+
+        std::ranges::sort(candidates);
+
+        auto evicted = std::size_t{0};
+
+        for (auto [last_used, id] : candidates) {
+          if (b.stats.used <= b.stats.budget) {
+            break;
+          }
+
+          auto size = b.entries[id].size;
+          c.erase(id);
+          b.entries.erase(id);
+
+          b.stats.used -= size;
+          b.stats.evictions++;
+          b.stats.evicted_bytes += size;
+          evicted++;
+        }
+
+        b.stats.resident = c.size();
+        return evicted;
+      }
+
+      static asset_stats stats() {
+        return budget().stats;
+      }
+
+      template <typename... Args>
+      requires std::is_move_assignable_v<typename A::resource_type>
+      static void watch(entt::id_type id, const std::filesystem::path& path, Args&&... args) {
+        unwatch(id);
+
+        auto token = file_watcher::main().watch(path, [id]() { reload(id); });
+        auto pins = pins_of(args...);
+
+        watched_assets().entries.emplace(id, watched{
+          .token = token,
+          .load = [...args = std::forward<Args>(args)]() {
+            return loader()(args...);
+          },
+          .pins = std::move(pins)
+        });
+
+        asset_queue::main().collect_with(&file_watcher::poll_main);
+      }
+
+      static void unwatch(entt::id_type id) {
+        auto& entries = watched_assets().entries;
+
+        if (auto it = entries.find(id); it != entries.end()) {
+          file_watcher::main().unwatch(it->second.token);
+          entries.erase(it);
+        }
+      }
+
+      static bool watching(entt::id_type id) {
+        return watched_assets().entries.contains(id);
+      }
+
+      static void reload(entt::id_type id) {
+        auto& entries = watched_assets().entries;
+        auto it = entries.find(id);
+
+        if (it == entries.end()) {
+          return;
+        }
+
+        // one reload in flight per asset, later changes are coalesced
+        if (it->second.loading) {
+          it->second.stale = true;
+          return;
+        }
+
+        it->second.loading = true;
+
+        for (auto* resource : it->second.pins) {
+          asset_queue::main().pin(resource);
+        }
+
+        asset_queue::main().submit([id, load = it->second.load, pins = it->second.pins]() {
+          auto value = typename A::loader_type::result_type{};
+          auto exc = std::exception_ptr{};
+
+          try {
+            value = load();
+          }
+          catch (...) {
+            exc = std::current_exception();
+          }
+
+          asset_queue::main().push([id, value = std::move(value), exc, pins]() mutable {
+            for (auto* resource : pins) {
+              asset_queue::main().unpin(resource);
+            }
+
+            swap(id, std::move(value), exc);
+          });
+        });
+      }
+
+      static std::size_t size_of(const typename A::resource_type& resource) {
+        if constexpr (sized_asset_trait<A>) {
+          return loader().size(resource);
+        }
+        else {
+          return sizeof(resource);
+        }
+      }
+
+    private:
+      static watches& watched_assets() {
+        return detail::singleton<watches>();
+      }
+
+      static void swap(entt::id_type id, typename A::loader_type::result_type value, std::exception_ptr exc) {
+        auto& entries = watched_assets().entries;
+        auto it = entries.find(id);
+
+        if (it == entries.end()) {
+          return;
+        }
+
+        if (!exc && !value) {
+          exc = std::make_exception_ptr(std::runtime_error("asset loader returned no resource"));
+        }
+
+        // loads on the worker pool may read the resource through the handles they
+        // were given, it is assigned once none of them is left
+        if (!exc && pinned(id)) {
+          it->second.deferred = std::move(value);
+          asset_queue::main().collect_with(&asset_manager::swap_deferred);
+          return;
+        }
+
+        it->second.loading = false;
+
+        // an asset that is not loaded, or evicted, reads the new file on its next load
+        auto loaded = cache().contains(id);
+
+        if (!exc && loaded) {
+          // assigned in place, so that existing handles see the new data
+          auto resource = cache()[id];
+          *resource = std::move(*value);
+
+          auto& b = budget();
+
+          if (auto entry = b.entries.find(id); entry != b.entries.end()) {
+            auto size = size_of(*resource);
+            b.stats.used = b.stats.used - entry->second.size + size;
+            entry->second.size = size;
+          }
+        }
+
+        if (exc || loaded) {
+          message_bus::main().enqueue(asset_reloaded<A>{.id = id, .error = exc});
+        }
+
+        if (std::exchange(it->second.stale, false)) {
+          reload(id);
+        }
+      }
+
+      static typename accounting::entry& account(entt::id_type id, const std::shared_ptr<typename A::resource_type>& resource) {
+        auto& b = budget();
+        auto [it, inserted] = b.entries.try_emplace(id, typename accounting::entry{.size = 0, .last_used = b.tick, .resource = {}});
+        auto& entry = it->second;
+
+        // a resource replaced with force_load() is measured again
+        if (inserted || entry.resource.owner_before(resource) || resource.owner_before(entry.resource)) {
+          auto size = size_of(*resource);
+          b.stats.used = b.stats.used - entry.size + size;
+          entry.size = size;
+          entry.resource = resource;
+        }
+
+        return entry;
+      }
+
+      static void refresh() {
+        auto& b = budget();
+        auto& c = cache();
+
+        for (auto it = b.entries.begin(); it != b.entries.end();) {
+          if (!c.contains(it->first)) {
+            b.stats.used -= it->second.size;
+            it = b.entries.erase(it);
+          }
+          else {
+            ++it;
+          }
+        }
+
+        for (auto [id, res] : c) {
+          static_cast<void>(account(id, res.handle()));
+        }
+      }
+
+      static std::size_t swap_deferred() {
+        auto swapped = std::size_t{0};
+
+        for (auto&& [id, w] : watched_assets().entries) {
+          if (w.deferred && !pinned(id)) {
+            auto value = std::move(*w.deferred);
+            w.deferred.reset();
+            swap(id, std::move(value), nullptr);
+            swapped++;
+          }
+        }
+
+        return swapped;
+      }
+
+      static bool pinned(entt::id_type id) {
+        return cache().contains(id) && asset_queue::main().pinned(cache()[id].handle().get());
+      }
+
+      template <typename... Args>
+      static std::vector<const void*> pins_of(const Args&... args) {
+        auto pins = std::vector<const void*>{};
+
+        ([&pins]<typename T>(const T& arg) {
+          if constexpr (is_resource<T>::value) {
+            if (arg) {
+              pins.push_back(arg.handle().get());
+            }
+          }
+        }(args), ...);
+
+        return pins;
+      }
+
+      static accounting& budget() {
+        return detail::singleton<accounting>();
+      }
+
+      static pending_loads& pending() {
+        return detail::singleton<pending_loads>();
+      }
+
+      static void complete(handle_type handle) {
+        auto& state = *handle.m_state;
+        pending().handles.erase(state.id);
+
+        if (!state.exc) {
+          // a synchronous load may have won the race
+          auto [it, loaded] = cache().load(state.id, preloaded_t{}, state.value);
+          state.value = it->second.handle();
+          static_cast<void>(account(state.id, state.value));
+        }
+
+        state.done = true;
+        message_bus::main().enqueue(asset_loaded<A>{.handle = handle});
+
+        for (auto& continuation : std::exchange(state.continuations, {})) {
+          continuation();
+        }
+      }
+  };
+
+  template <asset_trait A>
+  struct asset_ref {
+    using asset_type = A;
+
+    entt::id_type id;
+  };
+
+  struct asset_progress {
+    std::size_t total{0};
+    std::size_t loaded{0};
+    std::size_t failed{0};
+    std::size_t bytes{0};
+
+    bool done() const {
+      return loaded + failed == total;
+    }
+
+    float ratio() const {
+      return total > 0 ? static_cast<float>(loaded + failed) / static_cast<float>(total) : 1.0f;
+    }
+  };
+
+  class asset_manifest {
+    private:
+      using key_type = std::pair<entt::id_type, entt::id_type>;
+
+      struct dependency {
+        key_type key;
+        std::shared_ptr<void> (*cached)(entt::id_type);
+        std::shared_ptr<void> resource{nullptr};
+      };
+
+      template <typename T>
+      struct is_asset_ref : std::false_type {};
+
+      template <typename A>
+      struct is_asset_ref<asset_ref<A>> : std::true_type {};
+
+      struct state;
+
+      struct basic_entry {
+        virtual ~basic_entry() = default;
+        virtual void start(std::shared_ptr<state> s, std::size_t index) = 0;
+
+        key_type key;
+        std::vector<dependency> dependencies;
+        std::vector<std::size_t> dependents;
+        std::size_t waiting{0};
+        std::exception_ptr exc{nullptr};
+      };
+
+      struct state {
+        std::vector<std::unique_ptr<basic_entry>> entries;
+        asset_progress progress;
+        bool started{false};
+
+        void release(std::size_t index, bool success, std::size_t bytes, std::shared_ptr<void> resource = nullptr) {
+          auto& e = *entries[index];
+
+          if (success) {
+            progress.loaded++;
+            progress.bytes += bytes;
+          }
+          else {
+            progress.failed++;
+          }
+
+          for (auto dependent : e.dependents) {
+            auto& d = *entries[dependent];
+
+            if (!success && !d.exc) {
+              d.exc = e.exc;
+            }
+
+            // held until the dependent starts, so that it cannot be evicted meanwhile
+            for (auto& dep : d.dependencies) {
+              if (dep.key == e.key) {
+                dep.resource = resource;
+              }
+            }
+
+            if (--d.waiting == 0) {
+              if (d.exc) {
+                release(dependent, false, 0);
+              }
+              else {
+                d.start(self.lock(), dependent);
+              }
+            }
+          }
         }
 
-        return entt::locator<cache_type>::value();
+        std::weak_ptr<state> self;
+      };
+
+      template <asset_trait A, typename... Args>
+      struct entry final : basic_entry {
+        explicit entry(Args... args) : args(std::move(args)...) {}
+
+        void start(std::shared_ptr<state> s, std::size_t index) override {
+          auto handle = std::apply(
+            [this](auto&... a) {
+              return asset_manager<A>::load_async(key.second, resolve(std::move(a))...);
+            },
+            args
+          );
+
+          // the pending load holds the resolved resources now
+          for (auto& dep : dependencies) {
+            dep.resource.reset();
+          }
+
+          handle.then([s = std::move(s), index, handle]() {
+            auto& e = *s->entries[index];
+
+            if (handle.failed()) {
+              e.exc = handle.error();
+              s->release(index, false, 0);
+            }
+            else {
+              s->release(index, true, asset_manager<A>::size_of(*handle.resource()), handle.resource().handle());
+            }
+          });
+        }
+
+        template <typename T>
+        auto resolve(T arg) const {
+          if constexpr (is_asset_ref<T>::value) {
+            using resource_type = typename T::asset_type::resource_type;
+
+            auto dep = std::ranges::find(dependencies, key_of<typename T::asset_type>(arg.id), &dependency::key);
+            return entt::resource<resource_type>{std::static_pointer_cast<resource_type>(dep->resource)};
+          }
+          else {
+            return arg;
+          }
+        }
+
+        std::tuple<Args...> args;
+      };
+
+    public:
+      asset_manifest() : m_state(std::make_shared<state>()) {
+        m_state->self = m_state;
+      }
+
+      template <asset_trait A, typename... Args>
+      asset_manifest& add(entt::id_type id, Args&&... args) {
+        if (m_state->started) {
+          throw std::logic_error("manifest already preloaded");
+        }
+
+        auto e = std::make_unique<entry<A, std::decay_t<Args>...>>(std::forward<Args>(args)...);
+        e->key = key_of<A>(id);
+
+        ([&]<typename T>(const T& arg) {
+          if constexpr (is_asset_ref<T>::value) {
+            e->dependencies.push_back(dependency{
+              .key = key_of<typename T::asset_type>(arg.id),
+              .cached = &cached<typename T::asset_type>
+            });
+          }
+        }(args), ...);
+
+        m_state->entries.push_back(std::move(e));
+        return *this;
       }
+
+      void preload() {
+        auto& s = *m_state;
+
+        if (s.started) {
+          throw std::logic_error("manifest already preloaded");
+        }
+
+        auto index = std::map<key_type, std::size_t>{};
+
+        for (auto i = std::size_t{0}; i < s.entries.size(); ++i) {
+          if (!index.emplace(s.entries[i]->key, i).second) {
+            throw std::invalid_argument("duplicate asset in manifest");
+          }
+        }
+
+        // nothing is written to the entries until the manifest is valid, it can
+        // be fixed and preloaded again after a throw
+        auto dependents = std::vector<std::vector<std::size_t>>(s.entries.size());
+        auto waiting = std::vector<std::size_t>(s.entries.size());
+        auto pins = std::vector<std::vector<std::shared_ptr<void>>>(s.entries.size());
+
+        for (auto i = std::size_t{0}; i < s.entries.size(); ++i) {
+          for (auto& d : s.entries[i]->dependencies) {
+            auto& pin = pins[i].emplace_back();
+
+            if (auto it = index.find(d.key); it != index.end()) {
+              dependents[it->second].push_back(i);
+              waiting[i]++;
+            }
+            else if (pin = d.cached(d.key.second); pin == nullptr) {
+              throw std::invalid_argument("missing asset dependency");
+            }
+          }
+        }
+
+        check_acyclic(dependents, waiting);
+
+        for (auto i = std::size_t{0}; i < s.entries.size(); ++i) {
+          auto& e = *s.entries[i];
+          e.dependents = std::move(dependents[i]);
+          e.waiting = waiting[i];
+
+          for (auto j = std::size_t{0}; j < e.dependencies.size(); ++j) {
+            e.dependencies[j].resource = std::move(pins[i][j]);
+          }
+        }
+
+        s.started = true;
+        s.progress = asset_progress{.total = s.entries.size()};
+
+        // leaves are dispatched together, dependents follow as they complete
+        for (auto i = std::size_t{0}; i < s.entries.size(); ++i) {
+          if (s.entries[i]->waiting == 0) {
+            s.entries[i]->start(m_state, i);
+          }
+        }
+      }
+
+      const asset_progress& progress() const {
+        return m_state->progress;
+      }
+
+      std::size_t size() const {
+        return m_state->entries.size();
+      }
+
+      std::vector<std::pair<entt::id_type, std::exception_ptr>> errors() const {
+        auto result = std::vector<std::pair<entt::id_type, std::exception_ptr>>{};
+
+        for (auto& e : m_state->entries) {
+          if (e->exc) {
+            result.emplace_back(e->key.second, e->exc);
+          }
+        }
+
+        return result;
+      }
+
+    private:
+      template <asset_trait A>
+      static key_type key_of(entt::id_type id) {
+        return {entt::type_hash<A>::value(), id};
+      }
+
+      template <asset_trait A>
+      static std::shared_ptr<void> cached(entt::id_type id) {
+        auto& cache = asset_manager<A>::cache();
+        return cache.contains(id) ? cache[id].handle() : nullptr;
+      }
+
+      static void check_acyclic(const std::vector<std::vector<std::size_t>>& dependents, std::vector<std::size_t> waiting) {
+        auto ready = std::vector<std::size_t>{};
+        auto visited = std::size_t{0};
+
+        for (auto i = std::size_t{0}; i < waiting.size(); ++i) {
+          if (waiting[i] == 0) {
+            ready.push_back(i);
+          }
+        }
+
+        while (!ready.empty()) {
+          auto i = ready.back();
+          ready.pop_back();
+          visited++;
+
+          for (auto dependent : dependents[i]) {
+            if (--waiting[dependent] == 0) {
+              ready.push_back(dependent);
+            }
+          }
+        }
+
+        if (visited != waiting.size()) {
+          throw std::logic_error("cyclic asset dependencies");
+        }
+      }
+
+    private:
+      std::shared_ptr<state> m_state;
   };
 }
@@ -7,6 +7,8 @@
 
 #include "../entt/entt.hpp"
 
+#include "./singleton.hpp"
+
 namespace tw {
   class coroutine {
     public:
@@ -173,11 +175,7 @@ namespace tw {
   class coroutine_manager {
     public:
       static coroutine_manager& main() {
-        if (!entt::locator<coroutine_manager>::has_value()) {
-          entt::locator<coroutine_manager>::emplace();
-        }
-
-        return entt::locator<coroutine_manager>::value();
+        return detail::singleton<coroutine_manager>();
       }
 
       void start_coroutine(coroutine&& coro) {
@@ -0,0 +1,403 @@
+#pragma once
+
+#include <functional>
+#include <exception>
+#include <stdexcept>
+#include <cstddef>
+#include <cstring>
+#include <cstdint>
+#include <utility>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <mutex>
+
+#include <unistd.h>
+#include <sys/mman.h>
+
+#if defined(__x86_64__) && defined(__ELF__)
+#define TW_FIBER_ASM 1
+#else
+#include <ucontext.h>
+#endif
+
+#include "../entt/entt.hpp"
+
+#include "./singleton.hpp"
+#include "./workers.hpp"
+#include "./jobs.hpp"
+
+#ifdef TW_FIBER_ASM
+// saves the callee-saved registers on the current stack, and restores them from
+// the target stack, without the signal mask syscall made by swapcontext()
+extern "C" void tw_fiber_switch(void** from, void* to);
+
+asm(R"(
+  .pushsection .text.tw_fiber_switch,"axG",@progbits,tw_fiber_switch,comdat
+  .weak tw_fiber_switch
+  .type tw_fiber_switch, @function
+tw_fiber_switch:
+  pushq %rbp
+  pushq %rbx
+  pushq %r12
+  pushq %r13
+  pushq %r14
+  pushq %r15
+  subq $8, %rsp
+  stmxcsr (%rsp)
+  fnstcw 4(%rsp)
+  movq %rsp, (%rdi)
+  movq %rsi, %rsp
+  ldmxcsr (%rsp)
+  fldcw 4(%rsp)
+  addq $8, %rsp
+  popq %r15
+  popq %r14
+  popq %r13
+  popq %r12
+  popq %rbx
+  popq %rbp
+  ret
+  .size tw_fiber_switch, .-tw_fiber_switch
+  .popsection
+)");
+#endif
+
+namespace tw {
+  struct fiber_cancelled {};
+
+  class fiber_stack {
+    public:
+      explicit fiber_stack(std::size_t size) {
+        auto page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        m_size = (size + page - 1) / page * page;
+        m_guard = page;
+
+        auto flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+#ifdef MAP_STACK
+        flags |= MAP_STACK;
+#endif
+
+        auto* addr = ::mmap(nullptr, m_guard + m_size, PROT_READ | PROT_WRITE, flags, -1, 0);
+
+        if (addr == MAP_FAILED) {
+          throw std::bad_alloc();
+        }
+
+        // stacks grow down, an overflow faults on the guard page
+        ::mprotect(addr, m_guard, PROT_NONE);
+        m_base = static_cast<std::byte*>(addr);
+      }
+
+      fiber_stack(fiber_stack&& other) noexcept
+        : m_base(std::exchange(other.m_base, nullptr)),
+          m_size(std::exchange(other.m_size, 0)),
+          m_guard(std::exchange(other.m_guard, 0)) {}
+
+      fiber_stack& operator=(fiber_stack&& other) noexcept {
+        if (this != &other) {
+          release();
+          m_base = std::exchange(other.m_base, nullptr);
+          m_size = std::exchange(other.m_size, 0);
+          m_guard = std::exchange(other.m_guard, 0);
+        }
+
+        return *this;
+      }
+
+      fiber_stack(const fiber_stack&) = delete;
+      fiber_stack& operator=(const fiber_stack&) = delete;
+
+      ~fiber_stack() {
+        release();
+      }
+
+      std::byte* bottom() const {
+        return m_base + m_guard;
+      }
+
+      std::byte* top() const {
+        return bottom() + m_size;
+      }
+
+      std::size_t size() const {
+        return m_size;
+      }
+
+    private:
+      void release() {
+        if (m_base != nullptr) {
+          ::munmap(m_base, m_guard + m_size);
+          m_base = nullptr;
+        }
+      }
+
+    private:
+      std::byte* m_base{nullptr};
+      std::size_t m_size{0};
+      std::size_t m_guard{0};
+  };
+
+  class fiber_stack_pool {
+    public:
+      using stack_type = fiber_stack;
+
+      static fiber_stack_pool& main() {
+        return detail::singleton<fiber_stack_pool>();
+      }
+
+      explicit fiber_stack_pool(std::size_t stack_size = 64 * 1024) : m_stack_size(stack_size) {}
+
+      std::size_t stack_size() const {
+        return m_stack_size;
+      }
+
+      std::size_t available() {
+        auto lock = std::scoped_lock{m_mutex};
+        return m_stacks.size();
+      }
+
+      stack_type acquire() {
+        {
+          auto lock = std::scoped_lock{m_mutex};
+
+          if (!m_stacks.empty()) {
+            auto stack = std::move(m_stacks.back());
+            m_stacks.pop_back();
+            return stack;
+          }
+        }
+
+        return stack_type{m_stack_size};
+      }
+
+      void release(stack_type stack) {
+        auto lock = std::scoped_lock{m_mutex};
+        m_stacks.push_back(std::move(stack));
+      }
+
+    private:
+      std::size_t m_stack_size;
+      std::mutex m_mutex;
+      std::vector<stack_type> m_stacks;
+  };
+
+  class fiber {
+    public:
+      fiber(std::function<void()> func, fiber_stack_pool& pool = fiber_stack_pool::main())
+        : m_func(std::move(func)), m_pool(pool), m_stack(pool.acquire())
+      {
+#ifdef TW_FIBER_ASM
+        auto top = reinterpret_cast<std::uintptr_t>(m_stack.top()) & ~std::uintptr_t{15};
+        auto* sp = reinterpret_cast<void**>(top);
+
+        // the first switch "returns" in the trampoline, as if it was called
+        *--sp = nullptr;
+        *--sp = reinterpret_cast<void*>(&fiber::trampoline);
+
+        for (auto i = 0; i < 6; ++i) {
+          *--sp = nullptr;
+        }
+
+        --sp;
+        auto mxcsr = std::uint32_t{0x1f80};
+        auto fpucw = std::uint16_t{0x037f};
+        std::memcpy(sp, &mxcsr, sizeof(mxcsr));
+        std::memcpy(reinterpret_cast<std::byte*>(sp) + 4, &fpucw, sizeof(fpucw));
+
+        m_context = sp;
+#else
+        getcontext(&m_context);
+        m_context.uc_stack.ss_sp = m_stack.bottom();
+        m_context.uc_stack.ss_size = m_stack.size();
+        m_context.uc_link = nullptr;
+        makecontext(&m_context, &fiber::trampoline, 0);
+#endif
+      }
+
+      fiber(const fiber&) = delete;
+      fiber& operator=(const fiber&) = delete;
+
+      ~fiber() {
+        // a suspended fiber is unwound, so that its destructors run
+        if (m_started && !m_done) {
+          m_cancelled = true;
+
+          while (!m_done) {
+            enter();
+          }
+        }
+
+        m_pool.release(std::move(m_stack));
+      }
+
+      static fiber* current() {
+        return *current_slot();
+      }
+
+      bool done() const {
+        return m_done;
+      }
+
+      void resume() {
+        if (m_done) {
+          return;
+        }
+
+        enter();
+
+        if (m_exc) {
+          std::rethrow_exception(std::exchange(m_exc, nullptr));
+        }
+      }
+
+      void yield() {
+#ifdef TW_FIBER_ASM
+        tw_fiber_switch(&m_context, m_caller);
+#else
+        swapcontext(&m_context, &m_caller);
+#endif
+
+        if (m_cancelled) {
+          throw fiber_cancelled{};
+        }
+      }
+
+    private:
+      // the fiber may be resumed by another thread: the address of the
+      // thread local must not be cached across a switch
+      [[gnu::noinline]] static fiber** current_slot() {
+        thread_local fiber* current = nullptr;
+        auto* slot = &current;
+        asm volatile("" : "+r"(slot));
+        return slot;
+      }
+
+      void enter() {
+        auto* previous = std::exchange(*current_slot(), this);
+        m_started = true;
+
+#ifdef TW_FIBER_ASM
+        tw_fiber_switch(&m_caller, m_context);
+#else
+        swapcontext(&m_caller, &m_context);
+#endif
+
+        *current_slot() = previous;
+      }
+
+      static void trampoline() {
+        auto* self = current();
+
+        try {
+          self->m_func();
+        }
+        catch (const fiber_cancelled&) {}
+        catch (...) {
+          self->m_exc = std::current_exception();
+        }
+
+        self->m_done = true;
+
+#ifdef TW_FIBER_ASM
+        tw_fiber_switch(&self->m_context, self->m_caller);
+#else
+        setcontext(&self->m_caller);
+#endif
+      }
+
+    private:
+      std::function<void()> m_func;
+      fiber_stack_pool& m_pool;
+      fiber_stack_pool::stack_type m_stack;
+
+#ifdef TW_FIBER_ASM
+      void* m_context{nullptr};
+      void* m_caller{nullptr};
+#else
+      ucontext_t m_context;
+      ucontext_t m_caller;
+#endif
+
+      std::exception_ptr m_exc{nullptr};
+      bool m_started{false};
+      bool m_done{false};
+      bool m_cancelled{false};
+  };
+
+  namespace this_fiber {
+    inline void yield() {
+      if (auto* self = fiber::current(); self != nullptr) {
+        self->yield();
+      }
+    }
+  }
+
+  enum class fiber_affinity {
+    main_thread,
+    worker
+  };
+
+  class fiber_job : public job<fiber_job> {
+    private:
+      struct state {
+        fiber fib;
+        std::atomic<bool> running{false};
+        bool failed{false};
+
+        state(std::function<void()> func) : fib(std::move(func)) {}
+
+        void step() {
+          try {
+            fib.resume();
+          }
+          catch (...) {
+            failed = true;
+          }
+
+          running.store(false, std::memory_order_release);
+        }
+      };
+
+    public:
+      fiber_job(std::function<void()> func, fiber_affinity affinity = fiber_affinity::main_thread)
+        : m_state(std::make_shared<state>(std::move(func))), m_affinity(affinity) {}
+
+      void update(float, void*) {
+        if (m_state->running.load(std::memory_order_acquire)) {
+          return;
+        }
+
+        if (!finish()) {
+          m_state->running.store(true, std::memory_order_relaxed);
+
+          if (m_affinity == fiber_affinity::worker) {
+            worker_pool::main().submit([s = m_state]() { s->step(); });
+          }
+          else {
+            m_state->step();
+            finish();
+          }
+        }
+      }
+
+    private:
+      bool finish() {
+        if (m_state->failed) {
+          fail();
+          return true;
+        }
+        else if (m_state->fib.done()) {
+          succeed();
+          return true;
+        }
+
+        return false;
+      }
+
+    private:
+      std::shared_ptr<state> m_state;
+      fiber_affinity m_affinity;
+  };
+}
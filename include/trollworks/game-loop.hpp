@@ -13,8 +13,12 @@
 
 #include "./controlflow.hpp"
 #include "./coroutine.hpp"
+#include "./assets.hpp"
 #include "./messaging.hpp"
+#include "./scene.hpp"
+#include "./world.hpp"
 #include "./jobs.hpp"
+#include "./io.hpp"
 
 namespace tw {
   template <typename B>
@@ -73,6 +77,11 @@ namespace tw {
         return *this;
       }
 
+      game_loop& with_world(world& w) {
+        m_world = &w;
+        return *this;
+      }
+
       template <backend_trait B>
       game_loop& with_backend(B& backend) {
         on_setup<&B::setup>(backend);
@@ -148,6 +157,7 @@ namespace tw {
 
       void run() {
         auto cf = controlflow::running;
+        auto& w = m_world != nullptr ? *m_world : world::main();
 
         publish(m_sig_setup, cf);
 
@@ -164,6 +174,17 @@ namespace tw {
 
           publish(m_sig_frame_begin, cf);
 
+          // the asset caches are shared by every world
+          if (&w == &world::main()) {
+            asset_queue::main().update();
+
+            if (entt::locator<io_service>::has_value()) {
+              io_service::main().poll();
+            }
+          }
+
+          w.messages().update(dispatch_phase::before_fixed_update);
+
           auto fixed_delta_time = 1.0f / m_ups;
           while (lag >= fixed_delta_time) {
             publish(m_sig_fixed_update, fixed_delta_time, cf);
@@ -171,14 +192,16 @@ namespace tw {
           }
 
           publish(m_sig_update, delta_time, cf);
-          coroutine_manager::main().update();
+          w.messages().update(dispatch_phase::after_update);
+          w.coroutines().update();
           publish(m_sig_late_update, delta_time, cf);
-          job_manager::main().update(delta_time, &cf);
-          message_bus::main().update();
+          w.jobs().update(delta_time, &cf);
+          w.messages().update(dispatch_phase::before_render);
 
           publish(m_sig_render);
 
           publish(m_sig_frame_end, cf);
+          w.scenes().update();
 
           auto frame_end = std::chrono::high_resolution_clock::now();
           auto frame_duration = frame_end - current_time;
@@ -208,5 +231,6 @@ namespace tw {
     private:
       float m_fps{0.0f};
       float m_ups{50.0f};
+      world* m_world{nullptr};
   };
 }
@@ -0,0 +1,360 @@
+#pragma once
+
+#include <filesystem>
+#include <cerrno>
+#include <cstddef>
+#include <utility>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#if __has_include(<unistd.h>)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#define TW_IO_POSIX 1
+#else
+#include <fstream>
+#endif
+
+#if defined(TW_IO_POSIX) && defined(TW_WITH_IO_URING) && __has_include(<liburing.h>)
+#include <liburing.h>
+#define TW_IO_URING 1
+#endif
+
+#include "../entt/entt.hpp"
+
+#include "./singleton.hpp"
+#include "./messaging.hpp"
+#include "./workers.hpp"
+#include "./jobs.hpp"
+
+namespace tw {
+  enum class io_status {
+    pending,
+    succeeded,
+    failed
+  };
+
+  enum class io_operation {
+    read,
+    write
+  };
+
+  class io_request {
+    public:
+      io_request(io_operation op, std::filesystem::path path, std::vector<std::byte> buffer = {})
+        : m_op(op), m_path(std::move(path)), m_buffer(std::move(buffer)) {}
+
+      io_operation operation() const {
+        return m_op;
+      }
+
+      const std::filesystem::path& path() const {
+        return m_path;
+      }
+
+      io_status status() const {
+        return m_status.load(std::memory_order_acquire);
+      }
+
+      bool done() const {
+        return status() != io_status::pending;
+      }
+
+      int error() const {
+        return m_error;
+      }
+
+      std::vector<std::byte>& buffer() {
+        return m_buffer;
+      }
+
+      const std::vector<std::byte>& buffer() const {
+        return m_buffer;
+      }
+
+    private:
+      friend class io_service;
+
+      void complete(int error) {
+        m_error = error;
+        m_status.store(error == 0 ? io_status::succeeded : io_status::failed, std::memory_order_release);
+      }
+
+    private:
+      io_operation m_op;
+      std::filesystem::path m_path;
+      std::vector<std::byte> m_buffer;
+      std::atomic<io_status> m_status{io_status::pending};
+      int m_error{0};
+      int m_fd{-1};
+      std::size_t m_offset{0};
+  };
+
+  struct io_completed {
+    std::shared_ptr<io_request> request;
+  };
+
+  class io_service {
+    public:
+      static io_service& main() {
+        return detail::singleton<io_service>();
+      }
+
+      io_service() {
+#ifdef TW_IO_URING
+        m_uring = io_uring_queue_init(256, &m_ring, 0) == 0;
+#endif
+      }
+
+      io_service(const io_service&) = delete;
+      io_service& operator=(const io_service&) = delete;
+
+      ~io_service() {
+#ifdef TW_IO_URING
+        if (m_uring) {
+          io_uring_queue_exit(&m_ring);
+        }
+#endif
+      }
+
+      std::shared_ptr<io_request> read(std::filesystem::path path) {
+        return submit(std::make_shared<io_request>(io_operation::read, std::move(path)));
+      }
+
+      std::shared_ptr<io_request> write(std::filesystem::path path, std::vector<std::byte> data) {
+        return submit(std::make_shared<io_request>(io_operation::write, std::move(path), std::move(data)));
+      }
+
+      std::size_t pending() const {
+#ifdef TW_IO_URING
+        return m_inflight.size();
+#else
+        return 0;
+#endif
+      }
+
+      void poll() {
+#ifdef TW_IO_URING
+        if (!m_uring || m_inflight.empty()) {
+          return;
+        }
+
+        io_uring_cqe* cqe = nullptr;
+        auto resubmitted = false;
+
+        while (io_uring_peek_cqe(&m_ring, &cqe) == 0) {
+          auto* req = static_cast<io_request*>(io_uring_cqe_get_data(cqe));
+          auto res = cqe->res;
+          io_uring_cqe_seen(&m_ring, cqe);
+
+          if (res == -EINTR || res == -EAGAIN) {
+            resubmitted |= prepare(*req);
+            continue;
+          }
+
+          if (res > 0) {
+            req->m_offset += static_cast<std::size_t>(res);
+
+            // short transfers are resumed where they stopped
+            if (req->m_offset < req->m_buffer.size() && prepare(*req)) {
+              resubmitted = true;
+              continue;
+            }
+          }
+          else if (res == 0 && req->m_op == io_operation::read) {
+            req->m_buffer.resize(req->m_offset);
+          }
+
+          finish(*req, res < 0 ? -res : (req->m_offset < req->m_buffer.size() ? EIO : 0));
+        }
+
+        if (resubmitted) {
+          io_uring_submit(&m_ring);
+        }
+#endif
+      }
+
+    private:
+      std::shared_ptr<io_request> submit(std::shared_ptr<io_request> req) {
+#ifdef TW_IO_URING
+        if (m_uring && submit_uring(req)) {
+          return req;
+        }
+#endif
+
+        worker_pool::main().submit([req]() {
+          req->complete(execute(*req));
+        });
+
+        return req;
+      }
+
+#ifdef TW_IO_POSIX
+      static int open(io_request& req) {
+        if (req.m_op == io_operation::read) {
+          req.m_fd = ::open(req.m_path.c_str(), O_RDONLY | O_CLOEXEC);
+        }
+        else {
+          req.m_fd = ::open(req.m_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        }
+
+        if (req.m_fd < 0) {
+          return errno;
+        }
+
+        if (req.m_op == io_operation::read) {
+          struct stat st;
+
+          if (::fstat(req.m_fd, &st) < 0) {
+            auto err = errno;
+            ::close(req.m_fd);
+            return err;
+          }
+
+          req.m_buffer.resize(static_cast<std::size_t>(st.st_size));
+        }
+
+        return 0;
+      }
+
+      static int execute(io_request& req) {
+        if (auto err = open(req); err != 0) {
+          return err;
+        }
+
+        auto* data = req.m_buffer.data();
+        auto remaining = req.m_buffer.size();
+        auto err = 0;
+
+        while (remaining > 0) {
+          auto n = req.m_op == io_operation::read
+            ? ::read(req.m_fd, data, remaining)
+            : ::write(req.m_fd, data, remaining);
+
+          if (n < 0 && errno == EINTR) {
+            continue;
+          }
+          else if (n < 0) {
+            err = errno;
+            break;
+          }
+          else if (n == 0) {
+            req.m_buffer.resize(req.m_buffer.size() - remaining);
+            break;
+          }
+
+          data += n;
+          remaining -= static_cast<std::size_t>(n);
+        }
+
+        ::close(req.m_fd);
+        return err;
+      }
+#else
+      static int execute(io_request& req) {
+        if (req.m_op == io_operation::read) {
+          auto ec = std::error_code{};
+          auto size = std::filesystem::file_size(req.m_path, ec);
+          auto in = std::ifstream{req.m_path, std::ios::binary};
+
+          if (ec || !in) {
+            return ec ? ec.value() : ENOENT;
+          }
+
+          req.m_buffer.resize(static_cast<std::size_t>(size));
+          in.read(reinterpret_cast<char*>(req.m_buffer.data()), static_cast<std::streamsize>(size));
+          req.m_buffer.resize(static_cast<std::size_t>(in.gcount()));
+          return in.bad() ? EIO : 0;
+        }
+
+        auto out = std::ofstream{req.m_path, std::ios::binary | std::ios::trunc};
+        out.write(reinterpret_cast<const char*>(req.m_buffer.data()), static_cast<std::streamsize>(req.m_buffer.size()));
+        return out ? 0 : EIO;
+      }
+#endif
+
+#ifdef TW_IO_URING
+      bool submit_uring(const std::shared_ptr<io_request>& req) {
+        if (auto err = open(*req); err != 0) {
+          req->complete(err);
+          return true;
+        }
+
+        if (!prepare(*req)) {
+          ::close(req->m_fd);
+          return false;
+        }
+
+        io_uring_submit(&m_ring);
+        m_inflight.push_back(req);
+        return true;
+      }
+
+      bool prepare(io_request& req) {
+        auto* sqe = io_uring_get_sqe(&m_ring);
+
+        if (sqe == nullptr) {
+          return false;
+        }
+
+        auto* data = req.m_buffer.data() + req.m_offset;
+        auto remaining = req.m_buffer.size() - req.m_offset;
+
+        if (req.m_op == io_operation::read) {
+          io_uring_prep_read(sqe, req.m_fd, data, static_cast<unsigned>(remaining), req.m_offset);
+        }
+        else {
+          io_uring_prep_write(sqe, req.m_fd, data, static_cast<unsigned>(remaining), req.m_offset);
+        }
+
+        io_uring_sqe_set_data(sqe, &req);
+        return true;
+      }
+
+      void finish(io_request& req, int error) {
+        ::close(req.m_fd);
+        req.complete(error);
+
+        std::erase_if(m_inflight, [&req](const auto& r) { return r.get() == &req; });
+      }
+#endif
+
+    private:
+#ifdef TW_IO_URING
+      io_uring m_ring;
+      bool m_uring{false};
+      std::vector<std::shared_ptr<io_request>> m_inflight;
+#endif
+  };
+
+  class io_job : public job<io_job> {
+    public:
+      io_job(std::shared_ptr<io_request> request, message_bus& bus = message_bus::main())
+        : m_request(std::move(request)), m_bus(bus) {}
+
+      void update(float, void*) {
+        io_service::main().poll();
+
+        if (m_request->done()) {
+          m_bus.enqueue(io_completed{m_request});
+
+          if (m_request->status() == io_status::succeeded) {
+            succeed();
+          }
+          else {
+            fail();
+          }
+        }
+      }
+
+      const std::shared_ptr<io_request>& request() const {
+        return m_request;
+      }
+
+    private:
+      std::shared_ptr<io_request> m_request;
+      message_bus& m_bus;
+  };
+}
@@ -1,21 +1,188 @@
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <array>
+#include <stdexcept>
+
 #include "../entt/entt.hpp"
 
+#include "./singleton.hpp"
+
 namespace tw {
   template <typename T>
   using job = entt::process<T, float>;
 
+  enum class job_priority {
+    high,
+    normal,
+    low
+  };
+
   class job_manager {
     public:
       using scheduler = entt::basic_scheduler<float>;
 
-      static scheduler& main() {
-        if (!entt::locator<scheduler>::has_value()) {
-          entt::locator<scheduler>::emplace();
+      struct statistics {
+        std::size_t ticked{0};
+        std::size_t deferred{0};
+        float deferred_time{0.0f};
+      };
+
+    private:
+      struct slot {
+        scheduler jobs;
+        float delta{0.0f};
+      };
+
+    public:
+      static job_manager& main() {
+        return detail::singleton<job_manager>();
+      }
+
+      job_manager& with_budget(float seconds) {
+        if (seconds < 0.0f) {
+          throw std::invalid_argument("expected budget >= 0");
         }
 
-        return entt::locator<scheduler>::value();
+        m_budget = seconds;
+        return *this;
+      }
+
+      template <typename Proc, typename... Args>
+      scheduler& attach(Args&&... args) {
+        return m_high.attach<Proc>(std::forward<Args>(args)...);
+      }
+
+      template <typename Func>
+      scheduler& attach(Func&& func) {
+        return m_high.attach(std::forward<Func>(func));
+      }
+
+      // the schedulers of deferrable jobs move around their queue, none is handed out
+      template <typename Proc, typename... Args>
+      job_manager& attach(job_priority priority, Args&&... args) {
+        schedule(priority).template attach<Proc>(std::forward<Args>(args)...);
+        return *this;
       }
+
+      template <typename Func>
+      job_manager& attach(job_priority priority, Func&& func) {
+        schedule(priority).attach(std::forward<Func>(func));
+        return *this;
+      }
+
+      void update(float delta, void* data = nullptr) {
+        m_high.update(delta, data);
+        m_stats = statistics{};
+
+        auto start = std::chrono::high_resolution_clock::now();
+        auto exhausted = [&]() {
+          if (m_budget <= 0.0f || m_stats.ticked == 0) {
+            return false;
+          }
+
+          auto elapsed = std::chrono::high_resolution_clock::now() - start;
+          return std::chrono::duration<float>(elapsed).count() >= m_budget;
+        };
+
+        for (auto& q : m_queues) {
+          for (auto& s : q) {
+            s.delta += delta;
+          }
+
+          auto count = q.size();
+          auto ticked = std::size_t{0};
+
+          for (; ticked < count && !exhausted(); ++ticked) {
+            auto s = std::move(q.front());
+            q.pop_front();
+
+            s.jobs.update(s.delta, data);
+            s.delta = 0.0f;
+            m_stats.ticked++;
+
+            if (!s.jobs.empty()) {
+              q.push_back(std::move(s));
+            }
+          }
+
+          for (auto i = std::size_t{0}; i < count - ticked; ++i) {
+            m_stats.deferred++;
+            m_stats.deferred_time = std::max(m_stats.deferred_time, q[i].delta);
+          }
+
+          std::erase_if(q, [](const slot& s) { return s.jobs.empty(); });
+        }
+      }
+
+      void abort(bool immediate = false) {
+        m_high.abort(immediate);
+
+        for (auto& q : m_queues) {
+          for (auto& s : q) {
+            s.jobs.abort(immediate);
+          }
+        }
+      }
+
+      void clear() {
+        m_high.clear();
+
+        for (auto& q : m_queues) {
+          q.clear();
+        }
+      }
+
+      std::size_t size() const {
+        return m_high.size() + pending(job_priority::normal) + pending(job_priority::low);
+      }
+
+      bool empty() const {
+        return size() == 0;
+      }
+
+      std::size_t pending(job_priority priority) const {
+        if (priority == job_priority::high) {
+          return m_high.size();
+        }
+
+        auto count = std::size_t{0};
+
+        for (auto& s : queue(priority)) {
+          count += s.jobs.size();
+        }
+
+        return count;
+      }
+
+      const statistics& stats() const {
+        return m_stats;
+      }
+
+    private:
+      scheduler& schedule(job_priority priority) {
+        if (priority == job_priority::high) {
+          return m_high;
+        }
+
+        return queue(priority).emplace_back().jobs;
+      }
+
+      std::deque<slot>& queue(job_priority priority) {
+        return m_queues[static_cast<std::size_t>(priority) - 1];
+      }
+
+      const std::deque<slot>& queue(job_priority priority) const {
+        return m_queues[static_cast<std::size_t>(priority) - 1];
+      }
+
+    private:
+      float m_budget{0.0f};
+      scheduler m_high;
+      std::array<std::deque<slot>, 2> m_queues;
+      statistics m_stats;
   };
 }
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <filesystem>
+#include <stdexcept>
+#include <cstddef>
+#include <utility>
+#include <new>
+
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define TW_MAPPED_FILE_MMAP 1
+#else
+#include <fstream>
+#endif
+
+namespace tw {
+  class mapped_file {
+    public:
+      // without mmap, the file is read in a buffer with the same alignment guarantees
+      static constexpr std::size_t alignment = 64;
+
+      explicit mapped_file(const std::filesystem::path& path, bool sequential = false) {
+#ifdef TW_MAPPED_FILE_MMAP
+        auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+        if (fd < 0) {
+          throw std::runtime_error("unable to open " + path.string());
+        }
+
+        struct stat st;
+
+        if (::fstat(fd, &st) < 0) {
+          ::close(fd);
+          throw std::runtime_error("unable to stat " + path.string());
+        }
+
+        m_size = static_cast<std::size_t>(st.st_size);
+
+        if (m_size == 0) {
+          ::close(fd);
+          return;
+        }
+
+        auto flags = MAP_PRIVATE;
+
+#ifdef MAP_POPULATE
+        if (sequential) {
+          flags |= MAP_POPULATE;
+        }
+#endif
+
+        auto* addr = ::mmap(nullptr, m_size, PROT_READ, flags, fd, 0);
+        ::close(fd);
+
+        if (addr == MAP_FAILED) {
+          throw std::runtime_error("unable to map " + path.string());
+        }
+
+        if (sequential) {
+          ::madvise(addr, m_size, MADV_SEQUENTIAL);
+        }
+
+        m_data = static_cast<std::byte*>(addr);
+#else
+        static_cast<void>(sequential);
+
+        auto in = std::ifstream{path, std::ios::binary | std::ios::ate};
+
+        if (!in) {
+          throw std::runtime_error("unable to open " + path.string());
+        }
+
+        m_size = static_cast<std::size_t>(in.tellg());
+        in.seekg(0);
+
+        if (m_size == 0) {
+          return;
+        }
+
+        m_data = static_cast<std::byte*>(::operator new(m_size, std::align_val_t{alignment}));
+
+        if (!in.read(reinterpret_cast<char*>(m_data), static_cast<std::streamsize>(m_size))) {
+          release();
+          throw std::runtime_error("unable to read " + path.string());
+        }
+#endif
+      }
+
+      mapped_file(mapped_file&& other) noexcept
+        : m_data(std::exchange(other.m_data, nullptr)), m_size(std::exchange(other.m_size, 0)) {}
+
+      mapped_file& operator=(mapped_file&& other) noexcept {
+        if (this != &other) {
+          release();
+          m_data = std::exchange(other.m_data, nullptr);
+          m_size = std::exchange(other.m_size, 0);
+        }
+
+        return *this;
+      }
+
+      mapped_file(const mapped_file&) = delete;
+      mapped_file& operator=(const mapped_file&) = delete;
+
+      ~mapped_file() {
+        release();
+      }
+
+      const std::byte* data() const {
+        return m_data;
+      }
+
+      std::size_t size() const {
+        return m_size;
+      }
+
+    private:
+      void release() {
+        if (m_data == nullptr) {
+          return;
+        }
+
+#ifdef TW_MAPPED_FILE_MMAP
+        ::munmap(m_data, m_size);
+#else
+        ::operator delete(m_data, std::align_val_t{alignment});
+#endif
+
+        m_data = nullptr;
+      }
+
+    private:
+      std::byte* m_data{nullptr};
+      std::size_t m_size{0};
+  };
+}
@@ -1,16 +1,755 @@
 #pragma once
 
+#include <memory_resource>
+#include <type_traits>
+#include <string_view>
+#include <stdexcept>
+#include <algorithm>
+#include <ostream>
+#include <chrono>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <array>
+#include <mutex>
+#include <span>
+
 #include "../entt/entt.hpp"
 
+#include "./singleton.hpp"
+#include "./arena.hpp"
+
 namespace tw {
+  struct message_stats {
+    std::string_view name;
+    std::size_t enqueued{0};
+    std::size_t dispatched{0};
+    std::size_t high_water{0};
+    std::chrono::steady_clock::time_point start;
+    float duration{0.0f};
+    std::vector<float> listeners;
+    std::vector<float> batch_listeners;
+  };
+
+  enum class dispatch_phase {
+    before_fixed_update,
+    after_update,
+    before_render
+  };
+
+  enum class coalesce_policy {
+    keep_first,
+    keep_last,
+    merge
+  };
+
   class message_bus {
+    private:
+      template <typename Event>
+      struct basic_coalescer {
+        virtual ~basic_coalescer() = default;
+        virtual bool absorb(std::pmr::vector<Event>& events, Event& incoming) = 0;
+        virtual void reset() = 0;
+      };
+
+      template <typename Event, typename KeyFn, typename MergeFn>
+      class coalescer final : public basic_coalescer<Event> {
+        public:
+          using key_type = std::decay_t<std::invoke_result_t<KeyFn&, const Event&>>;
+
+          coalescer(KeyFn key_fn, MergeFn merge_fn, coalesce_policy policy)
+            : m_key_fn(std::move(key_fn)), m_merge_fn(std::move(merge_fn)), m_policy(policy) {}
+
+          bool absorb(std::pmr::vector<Event>& events, Event& incoming) override {
+            auto [it, inserted] = m_index.try_emplace(m_key_fn(std::as_const(incoming)), events.size());
+
+            if (inserted) {
+              return false;
+            }
+
+            auto& existing = events[it->second];
+
+            switch (m_policy) {
+              case coalesce_policy::keep_first:
+                break;
+
+              case coalesce_policy::keep_last:
+                existing = std::move(incoming);
+                break;
+
+              case coalesce_policy::merge:
+                if constexpr (!std::is_null_pointer_v<MergeFn>) {
+                  m_merge_fn(existing, std::move(incoming));
+                }
+                break;
+            }
+
+            return true;
+          }
+
+          void reset() override {
+            m_index.clear();
+          }
+
+        private:
+          KeyFn m_key_fn;
+          MergeFn m_merge_fn;
+          coalesce_policy m_policy;
+          entt::dense_map<key_type, std::size_t> m_index;
+      };
+
+      struct basic_channel {
+        virtual ~basic_channel() = default;
+        virtual void publish(std::pmr::memory_resource* next) = 0;
+        virtual void rebind(std::pmr::memory_resource* next) = 0;
+        virtual void disconnect(void* instance) = 0;
+        virtual void clear() = 0;
+        virtual std::size_t size() const = 0;
+        virtual void instrument(bool enabled) = 0;
+        virtual const message_stats* stats() const = 0;
+
+        dispatch_phase phase{dispatch_phase::before_render};
+        int priority{0};
+      };
+
+      template <typename Event>
+      class channel final : public basic_channel {
+        public:
+          using signal_type = entt::sigh<void(Event&)>;
+          using batch_signal_type = entt::sigh<void(std::span<const Event>)>;
+          using container_type = std::pmr::vector<Event>;
+
+          channel(std::pmr::memory_resource* resource) : m_events(resource) {}
+
+          void publish(std::pmr::memory_resource* next) override {
+            if (m_stats) {
+              m_stats->enqueued = std::exchange(m_enqueued, 0);
+              m_stats->high_water = std::exchange(m_high_water, 0);
+              m_stats->dispatched = m_events.size();
+              m_stats->start = std::chrono::steady_clock::now();
+              m_stats->duration = 0.0f;
+              m_stats->listeners.assign(m_signal.size(), 0.0f);
+              m_stats->batch_listeners.assign(m_batch_signal.size(), 0.0f);
+            }
+
+            if (m_events.empty()) {
+              if (m_events.get_allocator().resource() != next) {
+                replace(m_events, container_type{next});
+              }
+
+              return;
+            }
+
+            auto events = std::move(m_events);
+
+            if (m_coalescer) {
+              m_coalescer->reset();
+            }
+
+            replace(
+              m_events,
+              m_spare.get_allocator().resource() == next
+                ? std::move(m_spare)
+                : container_type{next}
+            );
+
+            if (m_stats) {
+              measure(m_batch_signal, m_stats->batch_listeners, std::span<const Event>{events});
+
+              for (auto& event : events) {
+                measure(m_signal, m_stats->listeners, event);
+              }
+
+              auto elapsed = std::chrono::steady_clock::now() - m_stats->start;
+              m_stats->duration = std::chrono::duration<float>(elapsed).count();
+            }
+            else {
+              m_batch_signal.publish(std::span<const Event>{events});
+
+              if (!m_signal.empty()) {
+                for (auto& event : events) {
+                  m_signal.publish(event);
+                }
+              }
+            }
+
+            events.clear();
+
+            if (events.get_allocator().resource() == next) {
+              replace(m_spare, std::move(events));
+            }
+          }
+
+          void rebind(std::pmr::memory_resource* next) override {
+            if (m_events.get_allocator().resource() == next) {
+              return;
+            }
+
+            auto events = container_type{next};
+            events.reserve(m_events.size());
+
+            for (auto& event : m_events) {
+              events.push_back(std::move(event));
+            }
+
+            replace(m_events, std::move(events));
+          }
+
+          void disconnect(void* instance) override {
+            sink().disconnect(instance);
+            batch_sink().disconnect(instance);
+          }
+
+          void clear() override {
+            m_events.clear();
+
+            if (m_coalescer) {
+              m_coalescer->reset();
+            }
+          }
+
+          std::size_t size() const override {
+            return m_events.size();
+          }
+
+          void instrument(bool enabled) override {
+            if (!enabled) {
+              m_stats.reset();
+            }
+            else if (!m_stats) {
+              m_stats = std::make_unique<message_stats>();
+              m_stats->name = entt::type_id<Event>().name();
+              m_enqueued = 0;
+              m_high_water = 0;
+            }
+          }
+
+          const message_stats* stats() const override {
+            return m_stats.get();
+          }
+
+          auto sink() {
+            return typename signal_type::sink_type{m_signal};
+          }
+
+          auto batch_sink() {
+            return typename batch_signal_type::sink_type{m_batch_signal};
+          }
+
+          void trigger(Event event) {
+            m_batch_signal.publish(std::span<const Event>{&event, 1});
+            m_signal.publish(event);
+          }
+
+          template <typename... Args>
+          void enqueue(Args&&... args) {
+            push(std::forward<Args>(args)...);
+
+            if (m_stats) {
+              m_enqueued++;
+              m_high_water = std::max(m_high_water, m_events.size());
+            }
+          }
+
+          void coalesce(std::unique_ptr<basic_coalescer<Event>> coalescer) {
+            m_coalescer = std::move(coalescer);
+          }
+
+        private:
+          template <typename... Args>
+          void push(Args&&... args) {
+            if (m_coalescer) {
+              auto event = make(std::forward<Args>(args)...);
+
+              if (!m_coalescer->absorb(m_events, event)) {
+                m_events.push_back(std::move(event));
+              }
+            }
+            else if constexpr (std::is_aggregate_v<Event> && (sizeof...(Args) != 0 || !std::is_default_constructible_v<Event>)) {
+              m_events.push_back(Event{std::forward<Args>(args)...});
+            }
+            else {
+              m_events.emplace_back(std::forward<Args>(args)...);
+            }
+          }
+
+          template <typename Signal, typename... Args>
+          static void measure(const Signal& signal, std::vector<float>& durations, Args&&... args) {
+            auto pos = signal.size();
+            auto last = std::chrono::steady_clock::now();
+
+            signal.collect(
+              [&]() {
+                auto now = std::chrono::steady_clock::now();
+                durations[--pos] += std::chrono::duration<float>(now - last).count();
+                last = now;
+              },
+              std::forward<Args>(args)...
+            );
+          }
+
+          template <typename... Args>
+          static Event make(Args&&... args) {
+            if constexpr (std::is_aggregate_v<Event>) {
+              return Event{std::forward<Args>(args)...};
+            }
+            else {
+              return Event(std::forward<Args>(args)...);
+            }
+          }
+
+          // polymorphic allocators do not propagate on assignment
+          static void replace(container_type& dest, container_type&& src) {
+            std::destroy_at(&dest);
+            std::construct_at(&dest, std::move(src));
+          }
+
+        private:
+          signal_type m_signal;
+          batch_signal_type m_batch_signal;
+          container_type m_events;
+          container_type m_spare;
+          std::unique_ptr<basic_coalescer<Event>> m_coalescer;
+          std::unique_ptr<message_stats> m_stats;
+          std::size_t m_enqueued{0};
+          std::size_t m_high_water{0};
+      };
+
+      struct basic_staged_message {
+        virtual ~basic_staged_message() = default;
+        virtual void enqueue(message_bus& bus) = 0;
+      };
+
+      template <typename Event>
+      struct staged_message final : basic_staged_message {
+        template <typename... Args>
+        staged_message(Args&&... args) : event{std::forward<Args>(args)...} {}
+
+        void enqueue(message_bus& bus) override {
+          bus.enqueue(std::move(event));
+        }
+
+        Event event;
+      };
+
+      // one per producer thread, the lock is only contended when the bus flushes
+      struct staging_buffer {
+        std::mutex mutex;
+        std::array<frame_arena, 2> arenas;
+        std::array<std::vector<basic_staged_message*>, 2> messages;
+        std::size_t active{0};
+
+        ~staging_buffer() {
+          for (auto& half : messages) {
+            for (auto* msg : half) {
+              std::destroy_at(msg);
+            }
+          }
+        }
+      };
+
     public:
-      static entt::dispatcher& main() {
-        if (!entt::locator<entt::dispatcher>::has_value()) {
-          entt::locator<entt::dispatcher>::emplace();
+      static message_bus& main() {
+        return detail::singleton<message_bus>();
+      }
+
+      message_bus() = default;
+      message_bus(const message_bus&) = delete;
+      message_bus& operator=(const message_bus&) = delete;
+
+      template <typename Event>
+      auto sink(entt::id_type id = entt::type_hash<Event>::value()) {
+        return assure<Event>(id).sink();
+      }
+
+      template <typename Event>
+      auto batch_sink(entt::id_type id = entt::type_hash<Event>::value()) {
+        return assure<Event>(id).batch_sink();
+      }
+
+      template <typename Event>
+      void trigger(Event&& event = {}) {
+        trigger(entt::type_hash<std::decay_t<Event>>::value(), std::forward<Event>(event));
+      }
+
+      template <typename Event>
+      void trigger(entt::id_type id, Event&& event = {}) {
+        assure<std::decay_t<Event>>(id).trigger(std::forward<Event>(event));
+      }
+
+      template <typename Event, typename... Args>
+      void enqueue(Args&&... args) {
+        enqueue_hint<Event>(entt::type_hash<Event>::value(), std::forward<Args>(args)...);
+      }
+
+      template <typename Event>
+      void enqueue(Event&& event) {
+        enqueue_hint(entt::type_hash<std::decay_t<Event>>::value(), std::forward<Event>(event));
+      }
+
+      template <typename Event, typename... Args>
+      void enqueue_hint(entt::id_type id, Args&&... args) {
+        assure<Event>(id).enqueue(std::forward<Args>(args)...);
+      }
+
+      template <typename Event>
+      void enqueue_hint(entt::id_type id, Event&& event) {
+        assure<std::decay_t<Event>>(id).enqueue(std::forward<Event>(event));
+      }
+
+      template <typename Event>
+      void post(Event&& event) {
+        stage<std::decay_t<Event>>(std::forward<Event>(event));
+      }
+
+      template <typename Event, typename... Args>
+      void post(Args&&... args) {
+        stage<Event>(std::forward<Args>(args)...);
+      }
+
+      template <typename Event, typename KeyFn>
+      message_bus& coalesce(KeyFn key_fn, coalesce_policy policy = coalesce_policy::keep_last) {
+        if (policy == coalesce_policy::merge) {
+          throw std::invalid_argument("expected a merge function");
+        }
+
+        using coalescer_type = coalescer<Event, KeyFn, std::nullptr_t>;
+        assure<Event>(entt::type_hash<Event>::value()).coalesce(
+          std::make_unique<coalescer_type>(std::move(key_fn), nullptr, policy)
+        );
+        return *this;
+      }
+
+      template <typename Event, typename KeyFn, typename MergeFn>
+      message_bus& coalesce(KeyFn key_fn, MergeFn merge_fn) {
+        using coalescer_type = coalescer<Event, KeyFn, MergeFn>;
+        assure<Event>(entt::type_hash<Event>::value()).coalesce(
+          std::make_unique<coalescer_type>(std::move(key_fn), std::move(merge_fn), coalesce_policy::merge)
+        );
+        return *this;
+      }
+
+      message_bus& with_stats(bool enabled = true) {
+        m_instrumented = enabled;
+
+        for (auto&& [id, chan] : m_channels) {
+          chan->instrument(enabled);
         }
 
-        return entt::locator<entt::dispatcher>::value();
+        return *this;
       }
+
+      template <typename Event>
+      const message_stats* stats(entt::id_type id = entt::type_hash<Event>::value()) const {
+        auto it = m_channels.find(id);
+        return it != m_channels.end() ? it->second->stats() : nullptr;
+      }
+
+      std::vector<message_stats> stats() const {
+        auto result = std::vector<message_stats>{};
+
+        for (auto&& [id, chan] : m_channels) {
+          if (auto* st = chan->stats(); st != nullptr) {
+            result.push_back(*st);
+          }
+        }
+
+        return result;
+      }
+
+      void write_trace(std::ostream& out) const {
+        auto us = [](std::chrono::steady_clock::time_point tp) {
+          return std::chrono::duration_cast<std::chrono::microseconds>(tp.time_since_epoch()).count();
+        };
+
+        auto quote = [](std::string_view text) {
+          auto result = std::string{"\""};
+
+          for (auto c : text) {
+            if (c == '"' || c == '\\') {
+              result += '\\';
+              result += c;
+            }
+            else if (static_cast<unsigned char>(c) < 0x20) {
+              constexpr auto digits = "0123456789abcdef";
+              result += "\\u00";
+              result += digits[(c >> 4) & 0xf];
+              result += digits[c & 0xf];
+            }
+            else {
+              result += c;
+            }
+          }
+
+          return result + '"';
+        };
+
+        auto separator = "";
+        out << "[";
+
+        for (auto& st : stats()) {
+          out << separator
+              << "{\"name\":" << quote(st.name) << ",\"cat\":\"message_bus\",\"ph\":\"C\",\"pid\":0,\"tid\":0"
+              << ",\"ts\":" << us(st.start)
+              << ",\"args\":{\"enqueued\":" << st.enqueued
+              << ",\"dispatched\":" << st.dispatched
+              << ",\"high_water\":" << st.high_water << "}}";
+          separator = ",";
+
+          out << separator
+              << "{\"name\":" << quote(st.name) << ",\"cat\":\"message_bus\",\"ph\":\"X\",\"pid\":0,\"tid\":0"
+              << ",\"ts\":" << us(st.start)
+              << ",\"dur\":" << st.duration * 1e6f
+              << ",\"args\":{\"listeners\":[";
+
+          for (auto i = std::size_t{0}; i < st.listeners.size(); ++i) {
+            out << (i > 0 ? "," : "") << st.listeners[i] * 1e6f;
+          }
+
+          out << "],\"batch_listeners\":[";
+
+          for (auto i = std::size_t{0}; i < st.batch_listeners.size(); ++i) {
+            out << (i > 0 ? "," : "") << st.batch_listeners[i] * 1e6f;
+          }
+
+          out << "]}}";
+        }
+
+        out << "]";
+      }
+
+      template <typename Type>
+      void disconnect(Type& instance) {
+        disconnect(&instance);
+      }
+
+      template <typename Type>
+      void disconnect(Type* instance) {
+        for (auto&& [id, chan] : m_channels) {
+          chan->disconnect(instance);
+        }
+      }
+
+      template <typename Event>
+      void clear(entt::id_type id = entt::type_hash<Event>::value()) {
+        assure<Event>(id).clear();
+      }
+
+      void clear() {
+        for (auto&& [id, chan] : m_channels) {
+          chan->clear();
+        }
+      }
+
+      template <typename Event>
+      std::size_t size(entt::id_type id = entt::type_hash<Event>::value()) const {
+        auto it = m_channels.find(id);
+        return it != m_channels.end() ? it->second->size() : 0;
+      }
+
+      std::size_t size() const {
+        auto count = std::size_t{0};
+
+        for (auto&& [id, chan] : m_channels) {
+          count += chan->size();
+        }
+
+        return count;
+      }
+
+      void flush() {
+        auto lock = std::scoped_lock{m_buffers_mutex};
+
+        for (auto& buffer : m_buffers) {
+          auto half = std::size_t{0};
+
+          {
+            auto buffer_lock = std::scoped_lock{buffer->mutex};
+
+            if (buffer->messages[buffer->active].empty()) {
+              continue;
+            }
+
+            half = std::exchange(buffer->active, 1 - buffer->active);
+          }
+
+          // the producer now stages in the other half
+          for (auto* msg : buffer->messages[half]) {
+            msg->enqueue(*this);
+            std::destroy_at(msg);
+          }
+
+          buffer->messages[half].clear();
+          buffer->arenas[half].reset();
+        }
+      }
+
+      template <typename Event>
+      message_bus& route(dispatch_phase phase, int priority = 0) {
+        auto& chan = assure<Event>(entt::type_hash<Event>::value());
+        chan.phase = phase;
+        chan.priority = priority;
+        m_sorted = false;
+        return *this;
+      }
+
+      template <typename Event>
+      void update(entt::id_type id = entt::type_hash<Event>::value()) {
+        flush();
+        assure<Event>(id).publish(resource());
+      }
+
+      void update() {
+        flush();
+        sort();
+
+        // listeners may create new channels, which grows m_order
+        for (auto pos = std::size_t{0}; pos < m_order.size(); ++pos) {
+          m_order[pos]->publish(next_resource());
+        }
+
+        end_frame();
+      }
+
+      void update(dispatch_phase phase) {
+        flush();
+        sort();
+
+        for (auto pos = std::size_t{0}; pos < m_order.size(); ++pos) {
+          if (m_order[pos]->phase == phase) {
+            m_order[pos]->publish(next_resource());
+          }
+        }
+
+        if (phase == dispatch_phase::before_render) {
+          for (auto* chan : m_order) {
+            chan->rebind(next_resource());
+          }
+
+          end_frame();
+        }
+      }
+
+      message_bus& with_frame_arena(
+        std::size_t block_size = 64 * 1024,
+        std::pmr::memory_resource* upstream = std::pmr::new_delete_resource()
+      ) {
+        // queued messages and spare buffers still live in the current arenas
+        if (m_arenas[0] != nullptr) {
+          throw std::logic_error("frame arenas are already configured");
+        }
+
+        for (auto& arena : m_arenas) {
+          arena = std::make_unique<frame_arena>(block_size, upstream);
+        }
+
+        return *this;
+      }
+
+    private:
+      template <typename Event>
+      channel<Event>& assure(entt::id_type id) {
+        static_assert(std::is_same_v<Event, std::decay_t<Event>>, "Non-decayed types not allowed");
+        auto& ptr = m_channels[id];
+
+        if (!ptr) {
+          ptr = std::make_unique<channel<Event>>(resource());
+          ptr->instrument(m_instrumented);
+          m_order.push_back(ptr.get());
+          m_sorted = false;
+        }
+
+        return static_cast<channel<Event>&>(*ptr);
+      }
+
+      std::pmr::memory_resource* resource() const {
+        if (m_arenas[m_active]) {
+          return m_arenas[m_active].get();
+        }
+
+        return std::pmr::new_delete_resource();
+      }
+
+      std::pmr::memory_resource* next_resource() const {
+        if (m_arenas[1 - m_active]) {
+          return m_arenas[1 - m_active].get();
+        }
+
+        return std::pmr::new_delete_resource();
+      }
+
+      void end_frame() {
+        auto* current = m_arenas[m_active].get();
+        m_active = 1 - m_active;
+
+        if (current != nullptr) {
+          current->reset();
+        }
+      }
+
+      void sort() {
+        if (!m_sorted) {
+          std::stable_sort(
+            m_order.begin(),
+            m_order.end(),
+            [](const basic_channel* a, const basic_channel* b) {
+              if (a->phase != b->phase) {
+                return a->phase < b->phase;
+              }
+
+              return a->priority > b->priority;
+            }
+          );
+
+          m_sorted = true;
+        }
+      }
+
+      template <typename Event, typename... Args>
+      void stage(Args&&... args) {
+        auto& buffer = local_buffer();
+        auto lock = std::scoped_lock{buffer.mutex};
+        auto alloc = std::pmr::polymorphic_allocator<>{&buffer.arenas[buffer.active]};
+
+        buffer.messages[buffer.active].push_back(
+          alloc.new_object<staged_message<Event>>(std::forward<Args>(args)...)
+        );
+      }
+
+      staging_buffer& local_buffer() {
+        // bus identifiers are never reused, stale entries are never matched
+        thread_local std::vector<std::pair<std::uint64_t, staging_buffer*>> buffers;
+
+        for (auto& [id, buffer] : buffers) {
+          if (id == m_id) {
+            return *buffer;
+          }
+        }
+
+        auto lock = std::scoped_lock{m_buffers_mutex};
+        auto* buffer = m_buffers.emplace_back(std::make_unique<staging_buffer>()).get();
+        buffers.emplace_back(m_id, buffer);
+        return *buffer;
+      }
+
+      static std::uint64_t next_id() {
+        static auto counter = std::atomic<std::uint64_t>{0};
+        return counter.fetch_add(1, std::memory_order_relaxed);
+      }
+
+    private:
+      entt::dense_map<entt::id_type, std::unique_ptr<basic_channel>, entt::identity> m_channels;
+      std::vector<basic_channel*> m_order;
+      bool m_sorted{true};
+      std::uint64_t m_id{next_id()};
+      std::mutex m_buffers_mutex;
+      std::vector<std::unique_ptr<staging_buffer>> m_buffers;
+      std::array<std::unique_ptr<frame_arena>, 2> m_arenas;
+      std::size_t m_active{0};
+      bool m_instrumented{false};
   };
 }
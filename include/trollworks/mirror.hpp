@@ -0,0 +1,282 @@
+#pragma once
+
+#include <type_traits>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <array>
+#include <tuple>
+#include <span>
+
+#include "../entt/entt.hpp"
+
+#include "./scene.hpp"
+
+namespace tw {
+  template <typename... Components>
+  class registry_mirror {
+    static_assert(sizeof...(Components) > 0, "At least one component type is required");
+    static_assert((!std::is_empty_v<Components> && ...), "Empty components cannot be mirrored");
+    static_assert((std::is_copy_assignable_v<Components> && ...), "Mirrored components must be copyable");
+
+    private:
+      template <typename Component>
+      struct column {
+        std::vector<entt::entity> entities;
+        std::vector<Component> components;
+      };
+
+    public:
+      class frame {
+        public:
+          std::uint64_t number() const {
+            return m_number;
+          }
+
+          template <typename Component>
+          std::span<const entt::entity> entities() const {
+            return std::get<column<Component>>(m_columns).entities;
+          }
+
+          template <typename Component>
+          std::span<const Component> components() const {
+            return std::get<column<Component>>(m_columns).components;
+          }
+
+          template <typename Component, typename Func>
+          void each(Func func) const {
+            auto& col = std::get<column<Component>>(m_columns);
+
+            for (auto i = std::size_t{0}; i < col.entities.size(); ++i) {
+              func(col.entities[i], col.components[i]);
+            }
+          }
+
+        private:
+          friend class registry_mirror;
+
+          std::uint64_t m_number{0};
+          std::tuple<column<Components>...> m_columns;
+      };
+
+    private:
+      static constexpr std::size_t column_count = sizeof...(Components);
+
+      struct slot {
+        std::shared_ptr<frame> data{std::make_shared<frame>()};
+        std::array<std::vector<bool>, column_count> dirty;
+        bool full{true};
+      };
+
+      template <typename Component>
+      static constexpr std::size_t column_index = entt::type_list_index_v<Component, entt::type_list<Components...>>;
+
+    public:
+      explicit registry_mirror(
+        scene_manager& scenes = scene_manager::main(),
+        std::size_t chunk_size = 1024
+      ) : registry_mirror(scenes.registry(), chunk_size) {
+        m_swap = scenes.on_swap().connect<&registry_mirror::rebind>(*this);
+      }
+
+      explicit registry_mirror(
+        entt::registry& registry,
+        std::size_t chunk_size = 1024
+      ) : m_registry(registry), m_chunk_size(std::max(chunk_size, std::size_t{1})) {}
+
+      registry_mirror(const registry_mirror&) = delete;
+      registry_mirror& operator=(const registry_mirror&) = delete;
+
+      std::shared_ptr<const frame> acquire() const {
+        return std::atomic_load_explicit(&m_latest, std::memory_order_acquire);
+      }
+
+      template <typename Component>
+      void touch(entt::entity entity) {
+        auto& storage = m_registry.storage<Component>();
+
+        if (storage.contains(entity)) {
+          mark(column_index<Component>, storage.index(entity));
+        }
+      }
+
+      void publish() {
+        (bind<Components>(), ...);
+        (reordered<Components>(), ...);
+
+        auto& target = next();
+
+        (sync<Components>(target), ...);
+
+        for (auto& dirty : target.dirty) {
+          dirty.assign(dirty.size(), false);
+        }
+
+        target.full = false;
+        target.data->m_number = ++m_number;
+        m_current = static_cast<std::size_t>(&target - m_slots.data());
+        std::atomic_store_explicit(&m_latest, target.data, std::memory_order_release);
+      }
+
+      std::size_t buffers() const {
+        return m_slots.size();
+      }
+
+    private:
+      slot& next() {
+        auto latest = std::atomic_load_explicit(&m_latest, std::memory_order_relaxed);
+
+        // a frame only referenced by the mirror is no longer read by anyone, the
+        // fence orders the readers' last accesses before the writes to come
+        for (auto& s : m_slots) {
+          if (s.data != latest && s.data.use_count() == 1) {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return s;
+          }
+        }
+
+        return m_slots.emplace_back();
+      }
+
+      template <typename Component>
+      void bind() {
+        auto& storage = m_registry.storage<Component>();
+        auto index = column_index<Component>;
+
+        if (m_storages[index] == &storage && m_connections[index].front()) {
+          return;
+        }
+
+        unbind(index);
+        m_storages[index] = &storage;
+
+        m_connections[index] = {
+          m_registry.on_construct<Component>().template connect<&registry_mirror::on_changed<Component>>(*this),
+          m_registry.on_update<Component>().template connect<&registry_mirror::on_changed<Component>>(*this),
+          m_registry.on_destroy<Component>().template connect<&registry_mirror::on_destroyed<Component>>(*this)
+        };
+
+        for (auto& s : m_slots) {
+          s.full = true;
+        }
+      }
+
+      void rebind(entt::registry&) {
+        // the previous registry is still alive while the swap is notified
+        for (auto index = std::size_t{0}; index < column_count; ++index) {
+          unbind(index);
+        }
+      }
+
+      void unbind(std::size_t index) {
+        for (auto& conn : m_connections[index]) {
+          conn.release();
+        }
+
+        m_storages[index] = nullptr;
+      }
+
+      template <typename Component>
+      void reordered() {
+        if (m_current >= m_slots.size() || m_slots[m_current].full) {
+          return;
+        }
+
+        auto& storage = m_registry.storage<Component>();
+        auto& latest = std::get<column<Component>>(m_slots[m_current].data->m_columns);
+        auto& dirty = m_slots[m_current].dirty[column_index<Component>];
+        auto size = std::min(storage.size(), latest.entities.size());
+
+        // sorting a storage or an owning group moves elements without any signal,
+        // the chunks unchanged since the last frame must still be in the same order
+        for (auto first = std::size_t{0}; first < size; first += m_chunk_size) {
+          auto chunk = first / m_chunk_size;
+          auto last = std::min(first + m_chunk_size, size);
+
+          if (chunk < dirty.size() && dirty[chunk]) {
+            continue;
+          }
+
+          if (!std::equal(storage.data() + first, storage.data() + last, latest.entities.begin() + first)) {
+            for (auto position = std::size_t{0}; position < storage.size(); position += m_chunk_size) {
+              mark(column_index<Component>, position);
+            }
+
+            return;
+          }
+        }
+      }
+
+      template <typename Component>
+      void on_changed(entt::registry& registry, entt::entity entity) {
+        mark(column_index<Component>, registry.storage<Component>().index(entity));
+      }
+
+      template <typename Component>
+      void on_destroyed(entt::registry& registry, entt::entity entity) {
+        auto& storage = registry.storage<Component>();
+
+        // the last element is moved in place of the removed one
+        mark(column_index<Component>, storage.index(entity));
+        mark(column_index<Component>, storage.size() - 1);
+      }
+
+      void mark(std::size_t column, std::size_t position) {
+        auto chunk = position / m_chunk_size;
+
+        for (auto& s : m_slots) {
+          auto& dirty = s.dirty[column];
+
+          if (dirty.size() <= chunk) {
+            dirty.resize(chunk + 1, false);
+          }
+
+          dirty[chunk] = true;
+        }
+      }
+
+      template <typename Component>
+      void sync(slot& target) {
+        auto& storage = m_registry.storage<Component>();
+        auto& col = std::get<column<Component>>(target.data->m_columns);
+        auto& dirty = target.dirty[column_index<Component>];
+        auto size = storage.size();
+
+        col.entities.resize(size);
+        col.components.resize(size);
+
+        for (auto first = std::size_t{0}; first < size; first += m_chunk_size) {
+          auto chunk = first / m_chunk_size;
+
+          if (!target.full && (chunk >= dirty.size() || !dirty[chunk])) {
+            continue;
+          }
+
+          auto last = std::min(first + m_chunk_size, size);
+          std::copy(storage.data() + first, storage.data() + last, col.entities.begin() + first);
+
+          // reverse iterators walk the packed array in ascending order
+          std::copy(
+            storage.rbegin() + static_cast<std::ptrdiff_t>(first),
+            storage.rbegin() + static_cast<std::ptrdiff_t>(last),
+            col.components.begin() + first
+          );
+        }
+      }
+
+    private:
+      entt::registry& m_registry;
+      std::size_t m_chunk_size;
+      std::array<const entt::sparse_set*, column_count> m_storages{};
+      std::array<std::array<entt::scoped_connection, 3>, column_count> m_connections;
+      std::vector<slot> m_slots;
+      std::size_t m_current{0};
+      std::shared_ptr<frame> m_latest;
+      std::uint64_t m_number{0};
+      entt::scoped_connection m_swap;
+  };
+}
@@ -0,0 +1,369 @@
+#pragma once
+
+#include <filesystem>
+#include <stdexcept>
+#include <optional>
+#include <cstring>
+#include <fstream>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <limits>
+#include <string_view>
+#include <string>
+#include <vector>
+#include <span>
+
+#if defined(TW_WITH_LZ4) && __has_include(<lz4.h>)
+#include <lz4.h>
+#define TW_PACK_LZ4 1
+#endif
+
+#if defined(TW_WITH_ZSTD) && __has_include(<zstd.h>)
+#include <zstd.h>
+#define TW_PACK_ZSTD 1
+#endif
+
+#include "../entt/entt.hpp"
+
+#include "./mapped-file.hpp"
+
+namespace tw {
+  enum class pack_compression : std::uint32_t {
+    none = 0,
+    lz4 = 1,
+    zstd = 2
+  };
+
+  namespace pack_format {
+    inline constexpr std::uint64_t magic = 0x74772d7061636b31; // "tw-pack1"
+    inline constexpr std::uint32_t version = 1;
+    inline constexpr std::size_t alignment = 64;
+
+    struct header {
+      std::uint64_t magic;
+      std::uint32_t version;
+      std::uint32_t count;
+      std::uint64_t index_offset;
+      std::uint64_t names_offset;
+    };
+
+    struct entry {
+      std::uint32_t id;
+      pack_compression compression;
+      std::uint64_t offset;
+      std::uint64_t size;
+      std::uint64_t stored_size;
+      std::uint32_t name_offset;
+      std::uint32_t name_size;
+    };
+
+    inline std::size_t align(std::size_t size) {
+      return (size + alignment - 1) / alignment * alignment;
+    }
+
+    inline bool supports(pack_compression compression) {
+      switch (compression) {
+        case pack_compression::none:
+          return true;
+
+#ifdef TW_PACK_LZ4
+        case pack_compression::lz4:
+          return true;
+#endif
+
+#ifdef TW_PACK_ZSTD
+        case pack_compression::zstd:
+          return true;
+#endif
+
+        default:
+          return false;
+      }
+    }
+  }
+
+  class pack_writer {
+    private:
+      struct pending_entry {
+        std::string name;
+        pack_compression compression;
+        std::size_t size;
+        std::vector<std::byte> data;
+      };
+
+    public:
+      static bool supports(pack_compression compression) {
+        return pack_format::supports(compression);
+      }
+
+      pack_writer& add(
+        std::string name,
+        std::span<const std::byte> data,
+        pack_compression compression = pack_compression::none
+      ) {
+        if (!supports(compression)) {
+          throw std::invalid_argument("unsupported pack compression");
+        }
+
+        auto id = entt::hashed_string::value(name.c_str(), name.size());
+
+        if (m_ids.contains(id)) {
+          throw std::invalid_argument("duplicate pack entry " + name);
+        }
+
+        m_ids.insert(id);
+        m_entries.push_back(pending_entry{
+          .name = std::move(name),
+          .compression = compression,
+          .size = data.size(),
+          .data = compress(data, compression)
+        });
+
+        return *this;
+      }
+
+      void write(const std::filesystem::path& path) const {
+        auto out = std::ofstream{path, std::ios::binary | std::ios::trunc};
+        auto index = std::vector<pack_format::entry>{};
+        auto names = std::string{};
+        auto offset = pack_format::alignment;
+
+        out.seekp(static_cast<std::streamoff>(offset));
+
+        for (auto& e : m_entries) {
+          index.push_back(pack_format::entry{
+            .id = entt::hashed_string::value(e.name.c_str(), e.name.size()),
+            .compression = e.compression,
+            .offset = offset,
+            .size = e.size,
+            .stored_size = e.data.size(),
+            .name_offset = static_cast<std::uint32_t>(names.size()),
+            .name_size = static_cast<std::uint32_t>(e.name.size())
+          });
+          names += e.name;
+
+          out.write(reinterpret_cast<const char*>(e.data.data()), static_cast<std::streamsize>(e.data.size()));
+          offset = pack_format::align(offset + e.data.size());
+          out.seekp(static_cast<std::streamoff>(offset));
+        }
+
+        auto header = pack_format::header{
+          .magic = pack_format::magic,
+          .version = pack_format::version,
+          .count = static_cast<std::uint32_t>(index.size()),
+          .index_offset = offset,
+          .names_offset = offset + index.size() * sizeof(pack_format::entry)
+        };
+
+        out.write(reinterpret_cast<const char*>(index.data()), static_cast<std::streamsize>(index.size() * sizeof(pack_format::entry)));
+        out.write(names.data(), static_cast<std::streamsize>(names.size()));
+        out.seekp(0);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        if (!out) {
+          throw std::runtime_error("unable to write pack " + path.string());
+        }
+      }
+
+    private:
+      static std::vector<std::byte> compress(std::span<const std::byte> data, pack_compression compression) {
+        auto result = std::vector<std::byte>{};
+
+        switch (compression) {
+#ifdef TW_PACK_LZ4
+          case pack_compression::lz4: {
+            // sizes are ints in the LZ4 API, below INT_MAX
+            if (data.size() > static_cast<std::size_t>(LZ4_MAX_INPUT_SIZE)) {
+              throw std::invalid_argument("entry too large for LZ4 compression");
+            }
+
+            result.resize(static_cast<std::size_t>(LZ4_compressBound(static_cast<int>(data.size()))));
+            auto size = LZ4_compress_default(
+              reinterpret_cast<const char*>(data.data()),
+              reinterpret_cast<char*>(result.data()),
+              static_cast<int>(data.size()),
+              static_cast<int>(result.size())
+            );
+
+            if (size <= 0) {
+              throw std::runtime_error("LZ4 compression failed");
+            }
+
+            result.resize(static_cast<std::size_t>(size));
+            break;
+          }
+#endif
+
+#ifdef TW_PACK_ZSTD
+          case pack_compression::zstd: {
+            result.resize(ZSTD_compressBound(data.size()));
+            auto size = ZSTD_compress(result.data(), result.size(), data.data(), data.size(), ZSTD_CLEVEL_DEFAULT);
+
+            if (ZSTD_isError(size)) {
+              throw std::runtime_error(ZSTD_getErrorName(size));
+            }
+
+            result.resize(size);
+            break;
+          }
+#endif
+
+          default:
+            result.assign(data.begin(), data.end());
+            break;
+        }
+
+        return result;
+      }
+
+    private:
+      std::vector<pending_entry> m_entries;
+      entt::dense_set<entt::id_type> m_ids;
+  };
+
+  class pack_reader {
+    public:
+      explicit pack_reader(const std::filesystem::path& path) : m_file(path) {
+        m_data = m_file.data();
+        m_size = m_file.size();
+
+        if (m_size < sizeof(pack_format::header)) {
+          throw std::runtime_error("invalid pack " + path.string());
+        }
+
+        auto header = pack_format::header{};
+        std::memcpy(&header, m_data, sizeof(header));
+
+        if (
+          header.magic != pack_format::magic ||
+          header.version != pack_format::version ||
+          header.index_offset < sizeof(header) ||
+          header.index_offset > m_size ||
+          header.index_offset % alignof(pack_format::entry) != 0 ||
+          header.count > (m_size - header.index_offset) / sizeof(pack_format::entry) ||
+          header.names_offset != header.index_offset + header.count * sizeof(pack_format::entry)
+        ) {
+          throw std::runtime_error("invalid pack " + path.string());
+        }
+
+        m_entries = reinterpret_cast<const pack_format::entry*>(m_data + header.index_offset);
+        m_names = reinterpret_cast<const char*>(m_data + header.names_offset);
+        m_index.reserve(header.count);
+
+        for (auto i = std::uint32_t{0}; i < header.count; ++i) {
+          if (!valid(m_entries[i], header)) {
+            throw std::runtime_error("invalid pack entry in " + path.string());
+          }
+
+          m_index.emplace(m_entries[i].id, i);
+        }
+      }
+
+      std::size_t size() const {
+        return m_index.size();
+      }
+
+      bool contains(entt::id_type id) const {
+        return m_index.contains(id);
+      }
+
+      std::string_view name(std::size_t index) const {
+        return {m_names + m_entries[index].name_offset, m_entries[index].name_size};
+      }
+
+      std::optional<std::span<const std::byte>> view(entt::id_type id) const {
+        auto* e = find(id);
+
+        if (e == nullptr || e->compression != pack_compression::none) {
+          return std::nullopt;
+        }
+
+        return std::span<const std::byte>{m_data + e->offset, e->size};
+      }
+
+      std::vector<std::byte> read(entt::id_type id) const {
+        auto* e = find(id);
+
+        if (e == nullptr) {
+          throw std::out_of_range("unknown pack entry");
+        }
+
+        auto stored = std::span<const std::byte>{m_data + e->offset, e->stored_size};
+        auto result = std::vector<std::byte>(e->size);
+
+        switch (e->compression) {
+          case pack_compression::none:
+            std::memcpy(result.data(), stored.data(), stored.size());
+            break;
+
+#ifdef TW_PACK_LZ4
+          case pack_compression::lz4:
+            if (LZ4_decompress_safe(
+              reinterpret_cast<const char*>(stored.data()),
+              reinterpret_cast<char*>(result.data()),
+              static_cast<int>(stored.size()),
+              static_cast<int>(result.size())
+            ) != static_cast<int>(result.size())) {
+              throw std::runtime_error("corrupted pack entry");
+            }
+            break;
+#endif
+
+#ifdef TW_PACK_ZSTD
+          case pack_compression::zstd:
+            if (ZSTD_decompress(result.data(), result.size(), stored.data(), stored.size()) != result.size()) {
+              throw std::runtime_error("corrupted pack entry");
+            }
+            break;
+#endif
+
+          default:
+            throw std::runtime_error("unsupported pack compression");
+        }
+
+        return result;
+      }
+
+    private:
+      bool valid(const pack_format::entry& e, const pack_format::header& header) const {
+        // the data lies between the header and the index, the names after the index
+        auto names_size = m_size - header.names_offset;
+
+        if (
+          e.offset < sizeof(header) ||
+          e.offset > header.index_offset ||
+          e.stored_size > header.index_offset - e.offset ||
+          e.name_offset > names_size ||
+          e.name_size > names_size - e.name_offset
+        ) {
+          return false;
+        }
+
+        switch (e.compression) {
+          case pack_compression::none:
+            return e.size == e.stored_size;
+
+          case pack_compression::lz4:
+            return e.size <= static_cast<std::uint64_t>(std::numeric_limits<int>::max()) &&
+              e.stored_size <= static_cast<std::uint64_t>(std::numeric_limits<int>::max());
+
+          default:
+            return true;
+        }
+      }
+
+      const pack_format::entry* find(entt::id_type id) const {
+        auto it = m_index.find(id);
+        return it != m_index.end() ? &m_entries[it->second] : nullptr;
+      }
+
+    private:
+      mapped_file m_file;
+      const std::byte* m_data{nullptr};
+      std::size_t m_size{0};
+      const pack_format::entry* m_entries{nullptr};
+      const char* m_names{nullptr};
+      entt::dense_map<entt::id_type, std::uint32_t, entt::identity> m_index;
+  };
+}
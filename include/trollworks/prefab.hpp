@@ -0,0 +1,91 @@
+#pragma once
+
+#include <type_traits>
+#include <algorithm>
+#include <iterator>
+#include <cstddef>
+#include <utility>
+#include <memory>
+#include <vector>
+
+#include "../entt/entt.hpp"
+
+namespace tw {
+  class prefab {
+    private:
+      struct basic_component {
+        virtual ~basic_component() = default;
+        virtual void insert(entt::registry& registry, const entt::entity* first, const entt::entity* last) const = 0;
+
+        entt::id_type id;
+      };
+
+      template <typename Component>
+      struct component final : basic_component {
+        component(entt::id_type id, Component value) : value(std::move(value)) {
+          this->id = id;
+        }
+
+        void insert(entt::registry& registry, const entt::entity* first, const entt::entity* last) const override {
+          auto& storage = registry.storage<Component>(id);
+
+          if constexpr (std::is_empty_v<Component>) {
+            storage.insert(first, last);
+          }
+          else {
+            storage.insert(first, last, value);
+          }
+        }
+
+        Component value;
+      };
+
+    public:
+      template <typename Component>
+      prefab& with(Component value = {}, entt::id_type id = entt::type_hash<Component>::value()) {
+        auto entry = std::make_unique<component<Component>>(id, std::move(value));
+        auto it = std::ranges::find_if(m_components, [id](auto& c) { return c->id == id; });
+
+        if (it != m_components.end()) {
+          *it = std::move(entry);
+        }
+        else {
+          m_components.push_back(std::move(entry));
+        }
+
+        return *this;
+      }
+
+      bool contains(entt::id_type id) const {
+        return std::ranges::any_of(m_components, [id](auto& c) { return c->id == id; });
+      }
+
+      std::size_t size() const {
+        return m_components.size();
+      }
+
+      template <typename It>
+      void instantiate(entt::registry& registry, It first, It last) const {
+        registry.create(first, last);
+
+        // storages expect a contiguous range of entities
+        if constexpr (std::contiguous_iterator<It>) {
+          insert(registry, std::to_address(first), std::to_address(first) + std::distance(first, last));
+        }
+        else {
+          auto entities = std::vector<entt::entity>(first, last);
+          insert(registry, entities.data(), entities.data() + entities.size());
+        }
+      }
+
+    private:
+      void insert(entt::registry& registry, const entt::entity* first, const entt::entity* last) const {
+        for (auto& c : m_components) {
+          c->insert(registry, first, last);
+        }
+      }
+
+    private:
+      std::vector<std::unique_ptr<basic_component>> m_components;
+  };
+}
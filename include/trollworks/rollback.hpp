@@ -0,0 +1,313 @@
+#pragma once
+
+#include <type_traits>
+#include <stdexcept>
+#include <algorithm>
+#include <optional>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <tuple>
+
+#include "../entt/entt.hpp"
+
+#include "./scene.hpp"
+
+namespace tw {
+  template <typename... Components>
+  class rollback_buffer {
+    static_assert(sizeof...(Components) > 0, "At least one component type is required");
+    static_assert((std::is_copy_constructible_v<Components> && ...), "Rolled back components must be copyable");
+
+    private:
+      template <typename Component>
+      struct undo {
+        entt::entity entity;
+        std::optional<Component> value;
+      };
+
+      template <typename Component>
+      struct track {
+        entt::dense_set<entt::entity> dirty;
+        entt::dense_map<entt::entity, Component> shadow;
+      };
+
+      struct delta {
+        std::uint64_t tick{0};
+        std::vector<entt::entity> created;
+        std::vector<entt::entity> destroyed;
+        std::tuple<std::vector<undo<Components>>...> undos;
+
+        void clear() {
+          created.clear();
+          destroyed.clear();
+          std::apply([](auto&... u) { (u.clear(), ...); }, undos);
+        }
+
+        std::size_t size() const {
+          return created.size() + destroyed.size() + std::apply(
+            [](auto&... u) { return (u.size() + ...); },
+            undos
+          );
+        }
+      };
+
+    public:
+      explicit rollback_buffer(
+        scene_manager& scenes = scene_manager::main(),
+        std::size_t capacity = 16
+      ) : rollback_buffer(scenes.registry(), capacity) {
+        // the history of the previous scene cannot be restored in the new one
+        m_swap = scenes.on_swap().connect<&rollback_buffer::reset>(*this);
+      }
+
+      explicit rollback_buffer(
+        entt::registry& registry,
+        std::size_t capacity = 16
+      ) : m_registry(registry), m_ring(std::max(capacity, std::size_t{1})) {
+        bind();
+      }
+
+      rollback_buffer(const rollback_buffer&) = delete;
+      rollback_buffer& operator=(const rollback_buffer&) = delete;
+
+      ~rollback_buffer() {
+        unbind();
+      }
+
+      void reset() {
+        unbind();
+        bind();
+
+        m_baseline = false;
+        m_first = 0;
+        m_count = 0;
+      }
+
+      void commit(std::uint64_t tick) {
+        if (!m_baseline) {
+          (rebuild<Components>(), ...);
+          m_created.clear();
+          m_destroyed.clear();
+          m_base = tick;
+          m_baseline = true;
+          return;
+        }
+
+        if (tick <= latest()) {
+          throw std::invalid_argument("ticks must be committed in increasing order");
+        }
+
+        if (m_count == m_ring.size()) {
+          m_base = m_ring[m_first].tick;
+          m_first = (m_first + 1) % m_ring.size();
+          m_count--;
+        }
+
+        auto& d = m_ring[(m_first + m_count) % m_ring.size()];
+        m_count++;
+
+        d.clear();
+        d.tick = tick;
+        record(d);
+      }
+
+      bool restore(std::uint64_t tick) {
+        if (!m_baseline || tick < m_base || tick > latest()) {
+          return false;
+        }
+
+        // changes made since the last commit are reverted first
+        m_scratch.clear();
+        record(m_scratch);
+        apply(m_scratch);
+
+        while (m_count > 0) {
+          auto& d = m_ring[(m_first + m_count - 1) % m_ring.size()];
+
+          if (d.tick <= tick) {
+            break;
+          }
+
+          apply(d);
+          m_count--;
+        }
+
+        return true;
+      }
+
+      std::uint64_t oldest() const {
+        return m_base;
+      }
+
+      std::uint64_t latest() const {
+        return m_count > 0 ? m_ring[(m_first + m_count - 1) % m_ring.size()].tick : m_base;
+      }
+
+      std::size_t changes(std::uint64_t tick) const {
+        for (auto i = std::size_t{0}; i < m_count; ++i) {
+          if (auto& d = m_ring[(m_first + i) % m_ring.size()]; d.tick == tick) {
+            return d.size();
+          }
+        }
+
+        return 0;
+      }
+
+    private:
+      void bind() {
+        m_registry.on_construct<entt::entity>().template connect<&rollback_buffer::on_created>(*this);
+        m_registry.on_destroy<entt::entity>().template connect<&rollback_buffer::on_destroyed>(*this);
+
+        (bind<Components>(), ...);
+      }
+
+      template <typename Component>
+      void bind() {
+        m_registry.on_construct<Component>().template connect<&rollback_buffer::on_changed<Component>>(*this);
+        m_registry.on_update<Component>().template connect<&rollback_buffer::on_changed<Component>>(*this);
+        m_registry.on_destroy<Component>().template connect<&rollback_buffer::on_changed<Component>>(*this);
+      }
+
+      void unbind() {
+        m_registry.on_construct<entt::entity>().disconnect(this);
+        m_registry.on_destroy<entt::entity>().disconnect(this);
+
+        ((
+          m_registry.on_construct<Components>().disconnect(this),
+          m_registry.on_update<Components>().disconnect(this),
+          m_registry.on_destroy<Components>().disconnect(this)
+        ), ...);
+      }
+
+      void on_created(entt::registry&, entt::entity entity) {
+        if (!m_restoring) {
+          m_created.insert(entity);
+        }
+      }
+
+      void on_destroyed(entt::registry&, entt::entity entity) {
+        if (!m_restoring && m_created.erase(entity) == 0) {
+          m_destroyed.insert(entity);
+        }
+      }
+
+      template <typename Component>
+      void on_changed(entt::registry&, entt::entity entity) {
+        if (!m_restoring) {
+          std::get<track<Component>>(m_tracks).dirty.insert(entity);
+        }
+      }
+
+      template <typename Component>
+      void rebuild() {
+        auto& t = std::get<track<Component>>(m_tracks);
+        t.dirty.clear();
+        t.shadow.clear();
+
+        for (auto [entity, component] : m_registry.storage<Component>().each()) {
+          t.shadow.emplace(entity, component);
+        }
+      }
+
+      void record(delta& d) {
+        d.created.assign(m_created.begin(), m_created.end());
+        d.destroyed.assign(m_destroyed.begin(), m_destroyed.end());
+        m_created.clear();
+        m_destroyed.clear();
+
+        (record<Components>(d), ...);
+      }
+
+      template <typename Component>
+      void record(delta& d) {
+        auto& t = std::get<track<Component>>(m_tracks);
+        auto& undos = std::get<std::vector<undo<Component>>>(d.undos);
+        auto& storage = m_registry.storage<Component>();
+
+        for (auto entity : t.dirty) {
+          auto previous = t.shadow.find(entity);
+          auto present = m_registry.valid(entity) && storage.contains(entity);
+
+          if (previous != t.shadow.end()) {
+            undos.push_back(undo<Component>{.entity = entity, .value = std::move(previous->second)});
+
+            if (present) {
+              previous->second = storage.get(entity);
+            }
+            else {
+              t.shadow.erase(previous);
+            }
+          }
+          else if (present) {
+            undos.push_back(undo<Component>{.entity = entity, .value = std::nullopt});
+            t.shadow.emplace(entity, storage.get(entity));
+          }
+        }
+
+        t.dirty.clear();
+      }
+
+      void apply(delta& d) {
+        m_restoring = true;
+
+        (remove<Components>(d), ...);
+
+        for (auto entity : d.created) {
+          if (m_registry.valid(entity)) {
+            m_registry.destroy(entity);
+          }
+        }
+
+        for (auto entity : d.destroyed) {
+          static_cast<void>(m_registry.create(entity));
+        }
+
+        (assign<Components>(d), ...);
+
+        m_restoring = false;
+      }
+
+      template <typename Component>
+      void remove(delta& d) {
+        auto& t = std::get<track<Component>>(m_tracks);
+
+        for (auto& u : std::get<std::vector<undo<Component>>>(d.undos)) {
+          if (!u.value) {
+            if (m_registry.valid(u.entity)) {
+              m_registry.remove<Component>(u.entity);
+            }
+
+            t.shadow.erase(u.entity);
+          }
+        }
+      }
+
+      template <typename Component>
+      void assign(delta& d) {
+        auto& t = std::get<track<Component>>(m_tracks);
+
+        for (auto& u : std::get<std::vector<undo<Component>>>(d.undos)) {
+          if (u.value) {
+            m_registry.emplace_or_replace<Component>(u.entity, *u.value);
+            t.shadow.insert_or_assign(u.entity, std::move(*u.value));
+          }
+        }
+      }
+
+    private:
+      entt::registry& m_registry;
+      std::vector<delta> m_ring;
+      std::size_t m_first{0};
+      std::size_t m_count{0};
+      std::uint64_t m_base{0};
+      bool m_baseline{false};
+      bool m_restoring{false};
+      delta m_scratch;
+      entt::dense_set<entt::entity> m_created;
+      entt::dense_set<entt::entity> m_destroyed;
+      std::tuple<track<Components>...> m_tracks;
+      entt::scoped_connection m_swap;
+  };
+}
@@ -1,11 +1,25 @@
 #pragma once
 
 #include <type_traits>
+#include <algorithm>
+#include <stdexcept>
+#include <exception>
 #include <concepts>
+#include <utility>
+#include <atomic>
 #include <memory>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <span>
 
 #include "../entt/entt.hpp"
 
+#include "./singleton.hpp"
+#include "./workers.hpp"
+#include "./prefab.hpp"
+
 namespace tw {
   class scene {
     public:
@@ -18,24 +32,437 @@ namespace tw {
   template <typename S>
   concept scene_trait = std::derived_from<S, scene>;
 
+  using scene_handle = entt::id_type;
+
+  struct scene_member {
+    scene_handle scene;
+  };
+
+  class scene_capacity {
+    public:
+      using factory_type = void (*)(entt::registry&, entt::id_type);
+      using factory_table = entt::dense_map<entt::id_type, factory_type, entt::identity>;
+
+      // a registry cannot create a storage from its identifier alone, profiles
+      // sharing a table can reserve any storage declared by one of them
+      scene_capacity() : scene_capacity(std::make_shared<factory_table>()) {}
+
+      explicit scene_capacity(std::shared_ptr<factory_table> factories) : m_factories(std::move(factories)) {}
+
+      scene_capacity& entities(std::size_t count) {
+        m_entities = std::max(m_entities, count);
+        return *this;
+      }
+
+      std::size_t entities() const {
+        return m_entities;
+      }
+
+      template <typename Type>
+      scene_capacity& reserve(std::size_t count, entt::id_type id = entt::type_hash<Type>::value()) {
+        auto& current = m_storages[id];
+        current = std::max(current, count);
+
+        (*m_factories)[id] = [](entt::registry& registry, entt::id_type id) {
+          static_cast<void>(registry.storage<Type>(id));
+        };
+
+        return *this;
+      }
+
+      std::size_t count(entt::id_type id) const {
+        auto it = m_storages.find(id);
+        return it != m_storages.end() ? it->second : 0;
+      }
+
+      void apply(entt::registry& registry) const {
+        registry.storage<entt::entity>().reserve(m_entities);
+
+        for (auto&& [id, count] : m_storages) {
+          if (auto factory = m_factories->find(id); factory != m_factories->end()) {
+            factory->second(registry, id);
+          }
+
+          if (auto* storage = registry.storage(id); storage != nullptr) {
+            storage->reserve(count);
+          }
+        }
+      }
+
+      void record(const entt::registry& registry) {
+        entities(registry.storage<entt::entity>()->free_list());
+
+        for (auto&& [id, storage] : registry.storage()) {
+          if (id != entt::type_hash<scene_member>::value()) {
+            update(id, storage.size());
+          }
+        }
+      }
+
+      void record(const entt::registry& registry, const entt::sparse_set& entities) {
+        this->entities(entities.size());
+
+        for (auto&& [id, storage] : registry.storage()) {
+          if (id == entt::type_hash<scene_member>::value()) {
+            continue;
+          }
+
+          auto* smaller = &storage;
+          auto* larger = &entities;
+
+          if (larger->size() < smaller->size()) {
+            std::swap(smaller, larger);
+          }
+
+          update(id, std::ranges::count_if(*smaller, [larger](auto entity) { return larger->contains(entity); }));
+        }
+      }
+
+      void write(std::ostream& out) const {
+        out << "entities " << m_entities << '\n';
+
+        for (auto&& [id, count] : m_storages) {
+          out << id << ' ' << count << '\n';
+        }
+      }
+
+      void read(std::istream& in) {
+        auto key = std::string{};
+        auto count = std::size_t{0};
+
+        while (in >> key >> count) {
+          if (key == "entities") {
+            entities(count);
+          }
+          else {
+            update(static_cast<entt::id_type>(std::stoul(key)), count);
+          }
+        }
+      }
+
+    private:
+      void update(entt::id_type id, std::size_t count) {
+        if (count > 0) {
+          auto& current = m_storages[id];
+          current = std::max(current, count);
+        }
+      }
+
+    private:
+      std::size_t m_entities{0};
+      entt::dense_map<entt::id_type, std::size_t, entt::identity> m_storages;
+      std::shared_ptr<factory_table> m_factories;
+  };
+
+  template <typename S>
+  concept scene_manifest = requires(scene_capacity& capacity) {
+    S::capacity(capacity);
+  };
+
+  enum class scene_teardown {
+    unload,
+    bulk
+  };
+
+  class scene_progress {
+    public:
+      scene_progress() : m_value(std::make_shared<std::atomic<float>>(0.0f)) {}
+
+      void report(float value) const {
+        m_value->store(value, std::memory_order_relaxed);
+      }
+
+      float value() const {
+        return m_value->load(std::memory_order_relaxed);
+      }
+
+    private:
+      std::shared_ptr<std::atomic<float>> m_value;
+  };
+
   class scene_manager {
+    private:
+      using teardown_signal = entt::sigh<void(entt::registry&, entt::sparse_set&)>;
+      using swap_signal = entt::sigh<void(entt::registry&)>;
+      using instantiate_signal = entt::sigh<void(entt::registry&, const prefab&, std::span<const entt::entity>)>;
+
+      struct staging {
+        std::unique_ptr<scene> instance;
+        entt::id_type profile;
+        entt::registry registry;
+        scene_progress progress;
+        std::exception_ptr exc{nullptr};
+        std::atomic<bool> done{false};
+      };
+
+      struct additive_scene {
+        scene_handle handle;
+        std::unique_ptr<scene> instance;
+        entt::sparse_set entities{};
+      };
+
     public:
       static scene_manager& main() {
-        if (!entt::locator<scene_manager>::has_value()) {
-          entt::locator<scene_manager>::emplace();
-        }
+        return detail::singleton<scene_manager>();
+      }
 
-        return entt::locator<scene_manager>::value();
+      scene_manager() {
+        m_registry.on_destroy<scene_member>().connect<&scene_manager::forget>(*this);
       }
 
+      scene_manager(const scene_manager&) = delete;
+      scene_manager& operator=(const scene_manager&) = delete;
+
       template <scene_trait S>
-      void load(S scene) {
-        if (m_scene) {
+      void load(S scene, scene_teardown teardown = scene_teardown::unload) {
+        if (loading()) {
+          throw std::logic_error("a scene is already being loaded");
+        }
+
+        if (teardown == scene_teardown::bulk) {
+          reset();
+        }
+        else if (m_scene) {
           m_scene->unload(m_registry);
         }
 
+        auto& profile = capacity<S>();
+        profile.apply(m_registry);
+
         m_scene = std::make_unique<S>(std::move(scene));
         m_scene->load(m_registry);
+
+        // the registry is shared with the additive scenes
+        auto* members = std::as_const(m_registry).storage<scene_member>();
+
+        if (members == nullptr || members->empty()) {
+          profile.record(m_registry);
+        }
+        else {
+          auto own = entt::sparse_set{};
+
+          for (auto [entity] : m_registry.storage<entt::entity>().each()) {
+            if (!members->contains(entity)) {
+              own.push(entity);
+            }
+          }
+
+          profile.record(m_registry, own);
+        }
+      }
+
+      void reset() {
+        auto* members = std::as_const(m_registry).storage<scene_member>();
+
+        if (members == nullptr || members->empty()) {
+          for (auto&& [id, storage] : m_registry.storage()) {
+            if (!storage.empty()) {
+              m_teardown.publish(m_registry, storage);
+            }
+          }
+
+          // storages keep their capacity, the next scene reuses the memory
+          m_registry.clear();
+        }
+        else {
+          teardown(*members);
+        }
+
+        m_scene.reset();
+      }
+
+      template <scene_trait S>
+      scene_capacity& capacity() {
+        auto [it, inserted] = m_capacity.try_emplace(entt::type_hash<S>::value(), m_factories);
+
+        if constexpr (scene_manifest<S>) {
+          if (inserted) {
+            S::capacity(it->second);
+          }
+        }
+
+        return it->second;
+      }
+
+      template <typename It>
+      void instantiate(const prefab& p, It first, It last) {
+        p.instantiate(m_registry, first, last);
+
+        if constexpr (std::contiguous_iterator<It>) {
+          m_instantiate.publish(m_registry, p, std::span<const entt::entity>{std::to_address(first), std::to_address(last)});
+        }
+        else {
+          auto entities = std::vector<entt::entity>(first, last);
+          m_instantiate.publish(m_registry, p, std::span<const entt::entity>{entities});
+        }
+      }
+
+      std::vector<entt::entity> instantiate(const prefab& p, std::size_t count) {
+        auto entities = std::vector<entt::entity>(count);
+        instantiate(p, entities.begin(), entities.end());
+        return entities;
+      }
+
+      auto on_instantiate() {
+        return instantiate_signal::sink_type{m_instantiate};
+      }
+
+      auto on_teardown() {
+        return teardown_signal::sink_type{m_teardown};
+      }
+
+      auto on_swap() {
+        return swap_signal::sink_type{m_swap};
+      }
+
+      template <scene_trait S>
+      void load_async(S scene) {
+        if (loading()) {
+          throw std::logic_error("a scene is already being loaded");
+        }
+
+        // entities cannot move between registries, they would be loaded again
+        if (!m_additive.empty()) {
+          throw std::logic_error("additive scenes must be unloaded before an asynchronous load");
+        }
+
+        auto stage = std::make_shared<staging>();
+        stage->instance = std::make_unique<S>(std::move(scene));
+        stage->profile = entt::type_hash<S>::value();
+        stage->registry.ctx().emplace<scene_progress>(stage->progress);
+        capacity<S>().apply(stage->registry);
+        m_staging = stage;
+
+        worker_pool::main().submit([stage]() {
+          try {
+            stage->instance->load(stage->registry);
+          }
+          catch (...) {
+            stage->exc = std::current_exception();
+          }
+
+          stage->progress.report(1.0f);
+          stage->done.store(true, std::memory_order_release);
+        });
+      }
+
+      template <scene_trait S>
+      scene_handle load_additive(S scene) {
+        if (loading()) {
+          throw std::logic_error("a scene is being loaded asynchronously");
+        }
+
+        auto handle = ++m_next_handle;
+
+        m_additive.push_back(additive_scene{
+          .handle = handle,
+          .instance = std::make_unique<S>(std::move(scene))
+        });
+
+        auto& profile = capacity<S>();
+        profile.apply(m_registry);
+
+        try {
+          load_tracked(m_additive.back());
+          profile.record(m_registry, m_additive.back().entities);
+        }
+        catch (...) {
+          destroy_members(m_additive.back());
+          m_additive.pop_back();
+          throw;
+        }
+
+        return handle;
+      }
+
+      void unload(scene_handle handle) {
+        auto it = find(handle);
+
+        it->instance->unload(m_registry);
+        destroy_members(*it);
+        m_additive.erase(it);
+      }
+
+      bool contains(scene_handle handle) const {
+        return std::any_of(
+          m_additive.begin(),
+          m_additive.end(),
+          [handle](const additive_scene& s) { return s.handle == handle; }
+        );
+      }
+
+      void adopt(scene_handle handle, entt::entity entity) {
+        auto& additive = *find(handle);
+
+        if (auto* current = m_registry.try_get<scene_member>(entity); current != nullptr) {
+          if (current->scene == handle) {
+            return;
+          }
+
+          m_registry.erase<scene_member>(entity);
+        }
+
+        m_registry.emplace<scene_member>(entity, handle);
+        additive.entities.push(entity);
+      }
+
+      void disown(scene_handle handle, entt::entity entity) {
+        if (member(handle, entity)) {
+          m_registry.erase<scene_member>(entity);
+        }
+      }
+
+      bool member(scene_handle handle, entt::entity entity) const {
+        auto* storage = m_registry.storage<scene_member>();
+        return storage != nullptr && storage->contains(entity) && storage->get(entity).scene == handle;
+      }
+
+      const entt::sparse_set& members(scene_handle handle) const {
+        return find(handle)->entities;
+      }
+
+      bool loading() const {
+        return m_staging != nullptr;
+      }
+
+      float progress() const {
+        return m_staging ? m_staging->progress.value() : 1.0f;
+      }
+
+      void update() {
+        if (!m_staging || !m_staging->done.load(std::memory_order_acquire)) {
+          return;
+        }
+
+        auto stage = std::move(m_staging);
+
+        if (stage->exc) {
+          std::rethrow_exception(stage->exc);
+        }
+
+        m_capacity.find(stage->profile)->second.record(stage->registry);
+
+        if (m_scene) {
+          m_scene->unload(m_registry);
+        }
+
+        auto retired = std::make_shared<entt::registry>(std::exchange(m_registry, std::move(stage->registry)));
+
+        // the context belongs to the game, not to the scene
+        m_registry.ctx() = std::move(retired->ctx());
+        m_scene = std::move(stage->instance);
+
+        retired->on_destroy<scene_member>().disconnect(this);
+        m_registry.on_destroy<scene_member>().connect<&scene_manager::forget>(*this);
+
+        // the storages lost their listeners, which may still disconnect from
+        // the previous registry
+        m_swap.publish(m_registry);
+
+        // destroying the previous scene would take as long as the scene is big
+        worker_pool::main().submit([retired = std::move(retired)]() mutable {
+          retired.reset();
+        });
       }
 
       const entt::registry& registry() const {
@@ -46,8 +473,106 @@ namespace tw {
         return m_registry;
       }
 
+    private:
+      std::vector<additive_scene>::iterator find(scene_handle handle) {
+        auto it = std::find_if(
+          m_additive.begin(),
+          m_additive.end(),
+          [handle](const additive_scene& s) { return s.handle == handle; }
+        );
+
+        if (it == m_additive.end()) {
+          throw std::invalid_argument("unknown scene handle");
+        }
+
+        return it;
+      }
+
+      std::vector<additive_scene>::const_iterator find(scene_handle handle) const {
+        return const_cast<scene_manager*>(this)->find(handle);
+      }
+
+      void load_tracked(additive_scene& additive) {
+        m_tracking = &additive;
+
+        auto conn = entt::scoped_connection{
+          m_registry.on_construct<entt::entity>().connect<&scene_manager::track>(*this)
+        };
+
+        additive.instance->load(m_registry);
+      }
+
+      void track(entt::registry& registry, entt::entity entity) {
+        registry.emplace<scene_member>(entity, m_tracking->handle);
+        m_tracking->entities.push(entity);
+      }
+
+      // destroyed or disowned, the entity leaves the list of its scene
+      void forget(entt::registry& registry, entt::entity entity) {
+        auto handle = registry.get<scene_member>(entity).scene;
+
+        for (auto& additive : m_additive) {
+          if (additive.handle == handle) {
+            additive.entities.remove(entity);
+          }
+        }
+      }
+
+      // the entities of additive scenes stay, only the outgoing scene is cleared
+      void teardown(const entt::sparse_set& members) {
+        auto outgoing = entt::sparse_set{};
+
+        for (auto&& [id, storage] : m_registry.storage()) {
+          if (storage.empty() || &storage == &members) {
+            continue;
+          }
+
+          if (std::none_of(members.begin(), members.end(), [&](auto entity) { return storage.contains(entity); })) {
+            m_teardown.publish(m_registry, storage);
+            storage.clear();
+            continue;
+          }
+
+          auto part = entt::sparse_set{storage.type()};
+
+          for (auto entity : storage) {
+            if (!members.contains(entity)) {
+              part.push(entity);
+            }
+          }
+
+          if (!part.empty()) {
+            m_teardown.publish(m_registry, part);
+            storage.erase(part.begin(), part.end());
+          }
+        }
+
+        for (auto [entity] : m_registry.storage<entt::entity>().each()) {
+          if (!members.contains(entity)) {
+            outgoing.push(entity);
+          }
+        }
+
+        m_registry.storage<entt::entity>().erase(outgoing.begin(), outgoing.end());
+      }
+
+      void destroy_members(additive_scene& additive) {
+        // destroying the entities would remove them from the list being iterated
+        auto entities = std::exchange(additive.entities, entt::sparse_set{});
+        m_registry.destroy(entities.begin(), entities.end());
+      }
+
     private:
       std::unique_ptr<scene> m_scene{nullptr};
       entt::registry m_registry;
+      std::shared_ptr<staging> m_staging{nullptr};
+      std::vector<additive_scene> m_additive;
+      scene_handle m_next_handle{0};
+      additive_scene* m_tracking{nullptr};
+      teardown_signal m_teardown;
+      swap_signal m_swap;
+      instantiate_signal m_instantiate;
+      entt::dense_map<entt::id_type, scene_capacity, entt::identity> m_capacity;
+      std::shared_ptr<scene_capacity::factory_table> m_factories{std::make_shared<scene_capacity::factory_table>()};
   };
 }
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <mutex>
+
+#include "../entt/entt.hpp"
+
+namespace tw::detail {
+  template <typename T>
+  std::mutex& singleton_mutex() {
+    static auto mutex = std::mutex{};
+    return mutex;
+  }
+
+  // the locator is checked on every call, a service reset by the game is
+  // provided again by the next call
+  template <typename T, typename Init>
+  T& singleton(Init init) {
+    auto lock = std::scoped_lock{singleton_mutex<T>()};
+
+    if (!entt::locator<T>::has_value()) {
+      init();
+    }
+
+    return entt::locator<T>::value();
+  }
+
+  template <typename T>
+  T& singleton() {
+    return singleton<T>([]() {
+      entt::locator<T>::emplace();
+    });
+  }
+}
@@ -0,0 +1,301 @@
+#pragma once
+
+#include <filesystem>
+#include <type_traits>
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <span>
+
+#include "../entt/entt.hpp"
+
+#include "./mapped-file.hpp"
+
+namespace tw {
+  namespace snapshot_format {
+    inline constexpr std::uint64_t magic = 0x74772d736e617031; // "tw-snap1"
+    inline constexpr std::uint32_t version = 1;
+    inline constexpr std::size_t alignment = 64;
+
+    struct file_header {
+      std::uint64_t magic;
+      std::uint32_t version;
+      std::uint32_t sections;
+    };
+
+    struct section_header {
+      std::uint32_t type;
+      std::uint32_t id;
+      std::uint32_t length;
+      std::uint32_t free_list;
+      std::uint64_t element_size;
+      std::uint64_t size;
+    };
+
+    inline std::size_t align(std::size_t size) {
+      return (size + alignment - 1) / alignment * alignment;
+    }
+
+    template <typename Type>
+    inline constexpr std::size_t element_size = std::is_empty_v<Type> || std::is_same_v<Type, entt::entity> ? 0 : sizeof(Type);
+
+    static_assert(sizeof(file_header) <= alignment);
+    static_assert(sizeof(section_header) <= alignment);
+  }
+
+  class snapshot_writer {
+    private:
+      using entity_traits = entt::entt_traits<entt::entity>;
+
+    public:
+      explicit snapshot_writer(const entt::registry& registry) : m_registry(registry) {
+        save<entt::entity>();
+      }
+
+      template <typename Type>
+      snapshot_writer& save(entt::id_type id = entt::type_hash<Type>::value()) {
+        static_assert(std::is_trivially_copyable_v<Type>, "Only trivially copyable components can be saved");
+        static_assert(alignof(Type) <= snapshot_format::alignment, "Over-aligned components are not supported");
+
+        m_section = m_buffer.size();
+        m_length = -1;
+        m_entities.clear();
+        m_components.clear();
+
+        auto header = snapshot_format::section_header{
+          .type = entt::type_hash<Type>::value(),
+          .id = id,
+          .length = 0,
+          .free_list = 0,
+          .element_size = snapshot_format::element_size<Type>,
+          .size = 0
+        };
+        m_buffer.resize(m_section + snapshot_format::alignment);
+        std::memcpy(m_buffer.data() + m_section, &header, sizeof(header));
+
+        entt::snapshot{m_registry}.get<Type>(*this, id);
+        flush();
+        m_sections++;
+
+        return *this;
+      }
+
+      void operator()(entity_traits::entity_type value) {
+        auto& header = section();
+
+        if (m_length < 0) {
+          header.length = value;
+          m_length = value;
+        }
+        else {
+          header.free_list = value;
+        }
+      }
+
+      void operator()(entt::entity entity) {
+        m_entities.push_back(entity);
+      }
+
+      template <typename Type>
+      void operator()(const Type& component) {
+        auto* bytes = reinterpret_cast<const std::byte*>(&component);
+        m_components.insert(m_components.end(), bytes, bytes + sizeof(Type));
+      }
+
+      std::span<const std::byte> data() const {
+        auto header = snapshot_format::file_header{
+          .magic = snapshot_format::magic,
+          .version = snapshot_format::version,
+          .sections = m_sections
+        };
+        std::memcpy(m_buffer.data(), &header, sizeof(header));
+
+        return m_buffer;
+      }
+
+      void write(const std::filesystem::path& path) const {
+        auto out = std::ofstream{path, std::ios::binary | std::ios::trunc};
+        auto bytes = data();
+
+        if (!out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()))) {
+          throw std::runtime_error("unable to write snapshot " + path.string());
+        }
+      }
+
+    private:
+      snapshot_format::section_header& section() {
+        return *reinterpret_cast<snapshot_format::section_header*>(m_buffer.data() + m_section);
+      }
+
+      void flush() {
+        auto entities = std::as_bytes(std::span{m_entities});
+        auto offset = m_buffer.size();
+
+        m_buffer.resize(snapshot_format::align(offset + entities.size()));
+        std::ranges::copy(entities, m_buffer.begin() + offset);
+
+        offset = m_buffer.size();
+        m_buffer.resize(snapshot_format::align(offset + m_components.size()));
+        std::ranges::copy(m_components, m_buffer.begin() + offset);
+
+        section().size = m_buffer.size() - m_section;
+      }
+
+    private:
+      const entt::registry& m_registry;
+      mutable std::vector<std::byte> m_buffer = std::vector<std::byte>(snapshot_format::alignment);
+      std::uint32_t m_sections{0};
+      std::size_t m_section{0};
+      std::int64_t m_length{-1};
+      std::vector<entt::entity> m_entities;
+      std::vector<std::byte> m_components;
+  };
+
+  class snapshot_reader {
+    private:
+      struct section {
+        const snapshot_format::section_header* header;
+        const entt::entity* entities;
+        const std::byte* components;
+      };
+
+    public:
+      snapshot_reader(const std::filesystem::path& path, entt::registry& registry)
+        : m_registry(registry), m_file(path, true) {
+        m_data = m_file.data();
+        m_size = m_file.size();
+
+        if (m_size < snapshot_format::alignment) {
+          throw std::runtime_error("invalid snapshot " + path.string());
+        }
+
+        index(path);
+        load_entities();
+      }
+
+      template <typename Type>
+      snapshot_reader& load(entt::id_type id = entt::type_hash<Type>::value()) {
+        static_assert(std::is_trivially_copyable_v<Type>, "Only trivially copyable components can be loaded");
+
+        auto* sec = find(id);
+
+        if (sec == nullptr) {
+          return *this;
+        }
+
+        if (
+          sec->header->type != entt::type_hash<Type>::value() ||
+          sec->header->element_size != snapshot_format::element_size<Type>
+        ) {
+          throw std::runtime_error("component layout does not match the snapshot");
+        }
+
+        auto& storage = m_registry.storage<Type>(id);
+        auto first = sec->entities;
+        auto last = first + sec->header->length;
+
+        if constexpr (std::is_empty_v<Type>) {
+          storage.insert(first, last);
+        }
+        else {
+          storage.insert(first, last, reinterpret_cast<const Type*>(sec->components));
+        }
+
+        return *this;
+      }
+
+    private:
+      void index(const std::filesystem::path& path) {
+        auto header = snapshot_format::file_header{};
+        std::memcpy(&header, m_data, sizeof(header));
+
+        if (header.magic != snapshot_format::magic) {
+          throw std::runtime_error("invalid snapshot " + path.string());
+        }
+
+        if (header.version != snapshot_format::version) {
+          throw std::runtime_error("unsupported snapshot version in " + path.string());
+        }
+
+        auto offset = snapshot_format::alignment;
+
+        for (auto i = std::uint32_t{0}; i < header.sections; ++i) {
+          if (offset + snapshot_format::alignment > m_size) {
+            throw std::runtime_error("truncated snapshot " + path.string());
+          }
+
+          auto* sec = reinterpret_cast<const snapshot_format::section_header*>(m_data + offset);
+
+          // sizes come from the file, they are compared without overflowing
+          if (sec->size > m_size - offset) {
+            throw std::runtime_error("truncated snapshot " + path.string());
+          }
+
+          if (sec->size < snapshot_format::alignment || sec->size % snapshot_format::alignment != 0) {
+            throw std::runtime_error("misaligned section in snapshot " + path.string());
+          }
+
+          auto entities = offset + snapshot_format::alignment;
+          auto components = snapshot_format::align(entities + sec->length * sizeof(entt::entity));
+
+          if (components - offset > sec->size) {
+            throw std::runtime_error("truncated snapshot " + path.string());
+          }
+
+          if (sec->element_size > 0 && sec->length > (sec->size - (components - offset)) / sec->element_size) {
+            throw std::runtime_error("truncated snapshot " + path.string());
+          }
+
+          m_sections.push_back(section{
+            .header = sec,
+            .entities = reinterpret_cast<const entt::entity*>(m_data + entities),
+            .components = m_data + components
+          });
+
+          offset += sec->size;
+        }
+      }
+
+      void load_entities() {
+        auto& storage = m_registry.storage<entt::entity>();
+
+        if (!storage.empty()) {
+          throw std::logic_error("snapshots must be loaded in an empty registry");
+        }
+
+        auto* sec = find(entt::type_hash<entt::entity>::value());
+
+        if (sec == nullptr) {
+          return;
+        }
+
+        storage.reserve(sec->header->length);
+
+        for (auto first = sec->entities, last = first + sec->header->length; first != last; ++first) {
+          storage.emplace(*first);
+        }
+
+        storage.free_list(sec->header->free_list);
+      }
+
+      const section* find(entt::id_type id) const {
+        auto it = std::ranges::find_if(m_sections, [id](const section& sec) {
+          return sec.header->id == id;
+        });
+
+        return it != m_sections.end() ? &*it : nullptr;
+      }
+
+    private:
+      entt::registry& m_registry;
+      mapped_file m_file;
+      const std::byte* m_data{nullptr};
+      std::size_t m_size{0};
+      std::vector<section> m_sections;
+  };
+}
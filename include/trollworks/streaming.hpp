@@ -0,0 +1,347 @@
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <algorithm>
+#include <optional>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <limits>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cmath>
+#include <span>
+
+#include "../entt/entt.hpp"
+
+#include "./workers.hpp"
+#include "./scene.hpp"
+#include "./io.hpp"
+
+namespace tw {
+  struct cell_coord {
+    std::int32_t x;
+    std::int32_t y;
+
+    bool operator==(const cell_coord&) const = default;
+  };
+
+  struct streaming_config {
+    float cell_size{256.0f};
+    std::int32_t load_radius{1};
+    std::int32_t unload_radius{2};
+    std::size_t memory_budget{256 * 1024 * 1024};
+    std::size_t installs_per_frame{4};
+  };
+
+  class cell_streamer {
+    public:
+      using path_fn = std::function<std::filesystem::path(cell_coord)>;
+      using decode_fn = std::function<void(cell_coord, std::span<const std::byte>, entt::registry&)>;
+      using inflate_fn = std::function<std::vector<std::byte>(cell_coord, std::vector<std::byte>)>;
+      using focus_handle = std::size_t;
+
+    private:
+      struct focus_point {
+        float x;
+        float y;
+      };
+
+      struct inflation {
+        std::vector<std::byte> data;
+        std::atomic<bool> done{false};
+      };
+
+      struct cell_state {
+        cell_coord coord;
+        std::shared_ptr<io_request> request;
+        std::shared_ptr<inflation> inflating{nullptr};
+        std::optional<std::vector<std::byte>> ready{std::nullopt};
+        std::optional<scene_handle> handle;
+        std::size_t bytes{0};
+
+        bool pending() const {
+          return request != nullptr || inflating != nullptr || ready.has_value();
+        }
+      };
+
+      class chunk_scene final : public scene {
+        public:
+          chunk_scene(cell_coord coord, std::vector<std::byte> data, const decode_fn& decode)
+            : m_coord(coord), m_data(std::move(data)), m_decode(decode) {}
+
+          virtual void load(entt::registry& registry) override {
+            // the bytes are not needed once the entities exist
+            auto data = std::exchange(m_data, {});
+            m_decode(m_coord, data, registry);
+          }
+
+          virtual void unload(entt::registry&) override {}
+
+        private:
+          cell_coord m_coord;
+          std::vector<std::byte> m_data;
+          std::reference_wrapper<const decode_fn> m_decode;
+      };
+
+    public:
+      cell_streamer(
+        streaming_config config,
+        path_fn path,
+        decode_fn decode,
+        scene_manager& scenes = scene_manager::main(),
+        io_service& io = io_service::main()
+      ) : m_config(config), m_path(std::move(path)), m_decode(std::move(decode)), m_scenes(scenes), m_io(io)
+      {
+        if (m_config.cell_size <= 0.0f) {
+          throw std::invalid_argument("cell size must be positive");
+        }
+
+        if (m_config.unload_radius < m_config.load_radius) {
+          throw std::invalid_argument("unload radius must not be smaller than the load radius");
+        }
+      }
+
+      cell_streamer(const cell_streamer&) = delete;
+      cell_streamer& operator=(const cell_streamer&) = delete;
+
+      ~cell_streamer() {
+        for (auto&& [key, cell] : m_cells) {
+          if (cell.handle) {
+            m_scenes.unload(*cell.handle);
+          }
+        }
+      }
+
+      focus_handle add_focus(float x, float y) {
+        auto handle = m_next_focus++;
+        m_focus[handle] = focus_point{.x = x, .y = y};
+        return handle;
+      }
+
+      void move_focus(focus_handle handle, float x, float y) {
+        m_focus[handle] = focus_point{.x = x, .y = y};
+      }
+
+      void remove_focus(focus_handle handle) {
+        m_focus.erase(handle);
+      }
+
+      cell_coord cell_at(float x, float y) const {
+        return cell_coord{
+          .x = static_cast<std::int32_t>(std::floor(x / m_config.cell_size)),
+          .y = static_cast<std::int32_t>(std::floor(y / m_config.cell_size))
+        };
+      }
+
+      cell_streamer& inflate(inflate_fn func) {
+        m_inflate = std::move(func);
+        return *this;
+      }
+
+      bool loaded(cell_coord coord) const {
+        auto it = m_cells.find(key(coord));
+        return it != m_cells.end() && !it->second.pending();
+      }
+
+      std::optional<scene_handle> handle(cell_coord coord) const {
+        auto it = m_cells.find(key(coord));
+        return it != m_cells.end() ? it->second.handle : std::nullopt;
+      }
+
+      std::size_t pending() const {
+        return std::ranges::count_if(m_cells, [](auto&& entry) { return entry.second.pending(); });
+      }
+
+      std::size_t memory() const {
+        return m_memory;
+      }
+
+      bool relocate(entt::entity entity, float x, float y) {
+        auto target = m_cells.find(key(cell_at(x, y)));
+
+        if (target == m_cells.end() || !target->second.handle) {
+          return false;
+        }
+
+        // an entity belongs to a single scene, adopting it leaves the previous cell
+        m_scenes.adopt(*target->second.handle, entity);
+        return true;
+      }
+
+      void update() {
+        m_io.poll();
+        install();
+        evict();
+        request();
+      }
+
+    private:
+      static std::uint64_t key(cell_coord coord) {
+        return (std::uint64_t{static_cast<std::uint32_t>(coord.x)} << 32) | static_cast<std::uint32_t>(coord.y);
+      }
+
+      std::int32_t distance(cell_coord coord) const {
+        auto result = std::numeric_limits<std::int32_t>::max();
+
+        for (auto&& [handle, focus] : m_focus) {
+          auto center = cell_at(focus.x, focus.y);
+          result = std::min(result, std::max(std::abs(coord.x - center.x), std::abs(coord.y - center.y)));
+        }
+
+        return result;
+      }
+
+      void install() {
+        auto installs = std::size_t{0};
+
+        for (auto&& [k, cell] : m_cells) {
+          if (cell.request != nullptr && cell.request->done()) {
+            auto req = std::exchange(cell.request, nullptr);
+
+            // a missing chunk is an empty cell
+            if (req->status() == io_status::succeeded && !req->buffer().empty()) {
+              inflate(cell, std::move(req->buffer()));
+            }
+          }
+
+          if (cell.inflating != nullptr && cell.inflating->done.load(std::memory_order_acquire)) {
+            auto job = std::exchange(cell.inflating, nullptr);
+
+            if (!job->data.empty()) {
+              cell.ready = std::move(job->data);
+            }
+          }
+
+          // creating the entities happens on the main thread, spread it over frames
+          if (cell.ready && installs < m_config.installs_per_frame && !m_scenes.loading()) {
+            auto data = std::move(*cell.ready);
+            cell.ready.reset();
+            cell.bytes = data.size();
+            cell.handle = m_scenes.load_additive(chunk_scene{cell.coord, std::move(data), m_decode});
+            m_memory += cell.bytes;
+            installs++;
+          }
+        }
+      }
+
+      void inflate(cell_state& cell, std::vector<std::byte> data) {
+        if (!m_inflate) {
+          cell.ready = std::move(data);
+          return;
+        }
+
+        auto job = std::make_shared<inflation>();
+        cell.inflating = job;
+
+        worker_pool::main().submit([job, coord = cell.coord, data = std::move(data), func = m_inflate]() mutable {
+          // a chunk that cannot be inflated is an empty cell
+          try {
+            job->data = func(coord, std::move(data));
+          }
+          catch (...) {
+            job->data.clear();
+          }
+
+          job->done.store(true, std::memory_order_release);
+        });
+      }
+
+      void evict() {
+        auto candidates = std::vector<std::pair<std::int32_t, std::uint64_t>>{};
+
+        for (auto&& [k, cell] : m_cells) {
+          auto d = distance(cell.coord);
+
+          if (d > m_config.unload_radius) {
+            candidates.emplace_back(std::numeric_limits<std::int32_t>::max(), k);
+          }
+          else if (d > m_config.load_radius && !cell.pending()) {
+            candidates.emplace_back(d, k);
+          }
+        }
+
+        // the farthest cells go first
+        std::ranges::sort(candidates, std::greater{});
+
+        for (auto [d, k] : candidates) {
+          if (d <= m_config.unload_radius && !over_budget()) {
+            break;
+          }
+
+          drop(k);
+        }
+      }
+
+      bool over_budget() const {
+        if (m_memory > m_config.memory_budget) {
+          return true;
+        }
+
+        // make room for the cells around the focus points
+        return m_memory == m_config.memory_budget && !wanted([this](cell_coord coord) {
+          return m_cells.contains(key(coord));
+        });
+      }
+
+      template <typename Func>
+      bool wanted(Func func) const {
+        for (auto&& [handle, focus] : m_focus) {
+          auto center = cell_at(focus.x, focus.y);
+
+          for (auto dy = -m_config.load_radius; dy <= m_config.load_radius; ++dy) {
+            for (auto dx = -m_config.load_radius; dx <= m_config.load_radius; ++dx) {
+              if (!func(cell_coord{.x = center.x + dx, .y = center.y + dy})) {
+                return false;
+              }
+            }
+          }
+        }
+
+        return true;
+      }
+
+      void request() {
+        wanted([this](cell_coord coord) {
+          if (m_memory >= m_config.memory_budget) {
+            return false;
+          }
+
+          if (!m_cells.contains(key(coord))) {
+            m_cells[key(coord)] = cell_state{
+              .coord = coord,
+              .request = m_io.read(m_path(coord)),
+              .handle = {}
+            };
+          }
+
+          return true;
+        });
+      }
+
+      void drop(std::uint64_t k) {
+        auto it = m_cells.find(k);
+
+        if (it->second.handle) {
+          m_scenes.unload(*it->second.handle);
+          m_memory -= it->second.bytes;
+        }
+
+        m_cells.erase(it);
+      }
+
+    private:
+      streaming_config m_config;
+      path_fn m_path;
+      decode_fn m_decode;
+      inflate_fn m_inflate;
+      scene_manager& m_scenes;
+      io_service& m_io;
+      entt::dense_map<focus_handle, focus_point> m_focus;
+      focus_handle m_next_focus{0};
+      entt::dense_map<std::uint64_t, cell_state> m_cells;
+      std::size_t m_memory{0};
+  };
+}
@@ -0,0 +1,343 @@
+#pragma once
+
+#include <type_traits>
+#include <stdexcept>
+#include <cstring>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cerrno>
+#include <utility>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <span>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../entt/entt.hpp"
+
+#include "./messaging.hpp"
+
+namespace tw {
+  class shm_ring {
+    protected:
+      static constexpr std::uint64_t magic = 0x74772d73686d3031; // "tw-shm01"
+
+      struct header {
+        std::uint64_t magic;
+        std::uint64_t capacity;
+        alignas(64) std::atomic<std::uint64_t> reserved;
+        alignas(64) std::atomic<std::uint64_t> head;
+      };
+
+      struct record {
+        std::uint32_t type;
+        std::uint32_t size;
+      };
+
+      static constexpr std::size_t record_align = 8;
+
+      shm_ring(std::string name, std::size_t capacity, bool create)
+        : m_name(std::move(name)), m_owner(create)
+      {
+        // never truncate a ring that a live publisher may still be writing to
+        auto flags = create ? O_CREAT | O_EXCL | O_RDWR : O_RDWR;
+        auto fd = ::shm_open(m_name.c_str(), flags, 0600);
+
+        if (fd < 0) {
+          if (create && errno == EEXIST) {
+            throw std::runtime_error("shared memory " + m_name + " already exists");
+          }
+
+          throw std::runtime_error("unable to open shared memory " + m_name);
+        }
+
+        if (create) {
+          m_size = sizeof(header) + capacity;
+
+          if (::ftruncate(fd, static_cast<off_t>(m_size)) < 0) {
+            ::close(fd);
+            ::shm_unlink(m_name.c_str());
+            throw std::runtime_error("unable to resize shared memory " + m_name);
+          }
+        }
+        else {
+          struct stat st;
+
+          if (::fstat(fd, &st) < 0 || static_cast<std::size_t>(st.st_size) < sizeof(header)) {
+            ::close(fd);
+            throw std::runtime_error("invalid shared memory " + m_name);
+          }
+
+          m_size = static_cast<std::size_t>(st.st_size);
+        }
+
+        auto* addr = ::mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+
+        if (addr == MAP_FAILED) {
+          if (create) {
+            ::shm_unlink(m_name.c_str());
+          }
+
+          throw std::runtime_error("unable to map shared memory " + m_name);
+        }
+
+        m_header = static_cast<header*>(addr);
+        m_data = static_cast<std::byte*>(addr) + sizeof(header);
+
+        if (create) {
+          std::construct_at(m_header);
+          m_header->capacity = capacity;
+          m_header->reserved.store(0, std::memory_order_relaxed);
+          m_header->head.store(0, std::memory_order_relaxed);
+          std::atomic_ref<std::uint64_t>{m_header->magic}.store(magic, std::memory_order_release);
+        }
+        else if (
+          std::atomic_ref<std::uint64_t>{m_header->magic}.load(std::memory_order_acquire) != magic ||
+          m_header->capacity == 0 ||
+          m_header->capacity % record_align != 0 ||
+          m_header->capacity > m_size - sizeof(header)
+        ) {
+          ::munmap(m_header, m_size);
+          throw std::runtime_error("invalid shared memory " + m_name);
+        }
+      }
+
+      shm_ring(const shm_ring&) = delete;
+      shm_ring& operator=(const shm_ring&) = delete;
+
+      ~shm_ring() {
+        ::munmap(m_header, m_size);
+
+        if (m_owner) {
+          ::shm_unlink(m_name.c_str());
+        }
+      }
+
+      static std::size_t align(std::size_t size) {
+        return (size + record_align - 1) / record_align * record_align;
+      }
+
+    protected:
+      std::string m_name;
+      bool m_owner;
+      std::size_t m_size{0};
+      header* m_header{nullptr};
+      std::byte* m_data{nullptr};
+  };
+
+  class shm_publisher : private shm_ring {
+    private:
+      struct basic_mirror {
+        virtual ~basic_mirror() = default;
+      };
+
+      template <typename Event>
+      struct mirroring final : basic_mirror {
+        mirroring(shm_publisher& publisher, message_bus& bus) : publisher(publisher), bus(bus) {
+          bus.batch_sink<Event>().template connect<&mirroring::on_events>(*this);
+        }
+
+        ~mirroring() override {
+          bus.batch_sink<Event>().template disconnect<&mirroring::on_events>(*this);
+        }
+
+        void on_events(std::span<const Event> events) {
+          for (auto& event : events) {
+            publisher.write(event);
+          }
+        }
+
+        shm_publisher& publisher;
+        message_bus& bus;
+      };
+
+    public:
+      shm_publisher(std::string name, std::size_t capacity = 1 << 20)
+        : shm_ring(std::move(name), align(capacity), true) {}
+
+      template <typename Event>
+      shm_publisher& mirror(message_bus& bus = message_bus::main()) {
+        m_mirrors.push_back(std::make_unique<mirroring<Event>>(*this, bus));
+        return *this;
+      }
+
+      template <typename Event>
+      void write(const Event& event) {
+        static_assert(std::is_trivially_copyable_v<Event>, "Only trivially copyable events can be shared");
+
+        write(
+          entt::type_hash<Event>::value(),
+          std::span<const std::byte>{reinterpret_cast<const std::byte*>(&event), sizeof(Event)}
+        );
+      }
+
+      void write(entt::id_type type, std::span<const std::byte> payload) {
+        auto capacity = m_header->capacity;
+        auto size = align(sizeof(record) + payload.size());
+
+        if (size > capacity / 2) {
+          throw std::invalid_argument("message too large for the shared memory ring");
+        }
+
+        auto head = m_header->head.load(std::memory_order_relaxed);
+        auto offset = head % capacity;
+
+        if (offset + size > capacity) {
+          // not enough room until the end of the ring, skip to the beginning
+          auto padding = capacity - offset;
+          publish(head, head + padding, 0, {});
+          head += padding;
+          offset = 0;
+        }
+
+        publish(head, head + size, type, payload);
+      }
+
+    private:
+      void publish(std::uint64_t head, std::uint64_t end, entt::id_type type, std::span<const std::byte> payload) {
+        auto* dest = m_data + head % m_header->capacity;
+
+        m_header->reserved.store(end, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        if (end - head >= sizeof(record)) {
+          auto rec = record{
+            .type = static_cast<std::uint32_t>(type),
+            .size = static_cast<std::uint32_t>(type == 0 ? end - head - sizeof(record) : payload.size())
+          };
+          std::memcpy(dest, &rec, sizeof(record));
+
+          if (!payload.empty()) {
+            std::memcpy(dest + sizeof(record), payload.data(), payload.size());
+          }
+        }
+
+        m_header->head.store(end, std::memory_order_release);
+      }
+
+    private:
+      std::vector<std::unique_ptr<basic_mirror>> m_mirrors;
+  };
+
+  class shm_subscriber : private shm_ring {
+    private:
+      struct forwarder {
+        message_bus* bus;
+        bool (*enqueue)(shm_subscriber&, message_bus&, std::uint64_t, std::span<const std::byte>);
+      };
+
+    public:
+      shm_subscriber(std::string name)
+        : shm_ring(std::move(name), 0, false),
+          m_tail(m_header->head.load(std::memory_order_acquire)) {}
+
+      template <typename Event>
+      shm_subscriber& forward(message_bus& bus = message_bus::main()) {
+        static_assert(std::is_trivially_copyable_v<Event>, "Only trivially copyable events can be shared");
+
+        m_forwarders[entt::type_hash<Event>::value()] = forwarder{
+          .bus = &bus,
+          .enqueue = [](shm_subscriber& self, message_bus& bus, std::uint64_t pos, std::span<const std::byte> payload) {
+            // a publisher built with another layout, or colliding type hashes
+            if (payload.size() != sizeof(Event)) {
+              self.m_mismatches++;
+              return true;
+            }
+
+            auto raw = std::array<std::byte, sizeof(Event)>{};
+            std::memcpy(raw.data(), payload.data(), sizeof(Event));
+            auto event = std::bit_cast<Event>(raw);
+
+            if (!self.valid(pos)) {
+              return false;
+            }
+
+            bus.enqueue(std::move(event));
+            return true;
+          }
+        };
+
+        return *this;
+      }
+
+      template <typename Func>
+      std::size_t poll(Func func) {
+        auto capacity = m_header->capacity;
+        auto head = m_header->head.load(std::memory_order_acquire);
+        auto count = std::size_t{0};
+
+        if (head - m_tail > capacity) {
+          overrun(head);
+        }
+
+        while (m_tail < head) {
+          auto rec = record{};
+          std::memcpy(&rec, m_data + m_tail % capacity, sizeof(record));
+
+          if (!valid(m_tail) || rec.size > capacity - m_tail % capacity - sizeof(record)) {
+            overrun(head);
+            break;
+          }
+
+          auto end = m_tail + align(sizeof(record) + rec.size);
+          auto payload = std::span<const std::byte>{m_data + m_tail % capacity + sizeof(record), rec.size};
+
+          if (rec.type != 0) {
+            if (!func(static_cast<entt::id_type>(rec.type), m_tail, payload)) {
+              overrun(head);
+              break;
+            }
+
+            count++;
+          }
+
+          m_tail = end;
+        }
+
+        return count;
+      }
+
+      std::size_t update() {
+        return poll([this](entt::id_type type, std::uint64_t pos, std::span<const std::byte> payload) {
+          if (auto it = m_forwarders.find(type); it != m_forwarders.end()) {
+            return it->second.enqueue(*this, *it->second.bus, pos, payload);
+          }
+
+          return true;
+        });
+      }
+
+      bool valid(std::uint64_t pos) const {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return m_header->reserved.load(std::memory_order_relaxed) - pos <= m_header->capacity;
+      }
+
+      std::size_t overruns() const {
+        return m_overruns;
+      }
+
+      std::size_t mismatches() const {
+        return m_mismatches;
+      }
+
+    private:
+      void overrun(std::uint64_t head) {
+        m_overruns++;
+        m_tail = head;
+      }
+
+    private:
+      std::uint64_t m_tail;
+      std::size_t m_overruns{0};
+      std::size_t m_mismatches{0};
+      entt::dense_map<entt::id_type, forwarder, entt::identity> m_forwarders;
+  };
+}
@@ -5,6 +5,8 @@
 
 #include "../entt/entt.hpp"
 
+#include "./singleton.hpp"
+
 namespace tw::ui {
   class hooks;
 
@@ -16,11 +18,7 @@ namespace tw::ui {
   class hooks {
     public:
       static hooks& main() {
-        if (!entt::locator<hooks>::has_value()) {
-          entt::locator<hooks>::emplace();
-        }
-
-        return entt::locator<hooks>::value();
+        return detail::singleton<hooks>();
       }
 
       void reset() {
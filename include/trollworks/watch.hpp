@@ -0,0 +1,189 @@
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <string>
+#include <vector>
+#include <array>
+#include <map>
+
+#if __has_include(<sys/inotify.h>)
+#include <sys/inotify.h>
+#include <unistd.h>
+#define TW_WATCH_INOTIFY 1
+#endif
+
+#include "../entt/entt.hpp"
+
+#include "./singleton.hpp"
+
+namespace tw {
+  class file_watcher {
+    private:
+      struct entry {
+        std::size_t token;
+        std::function<void()> callback;
+      };
+
+      struct directory {
+        std::filesystem::path path;
+        std::map<std::string, std::vector<entry>, std::less<>> files;
+      };
+
+    public:
+      static file_watcher& main() {
+        return detail::singleton<file_watcher>();
+      }
+
+      static std::size_t poll_main() {
+        return main().poll();
+      }
+
+      file_watcher() {
+#ifdef TW_WATCH_INOTIFY
+        m_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+      }
+
+      file_watcher(const file_watcher&) = delete;
+      file_watcher& operator=(const file_watcher&) = delete;
+
+      ~file_watcher() {
+#ifdef TW_WATCH_INOTIFY
+        if (m_fd >= 0) {
+          ::close(m_fd);
+        }
+#endif
+      }
+
+      bool enabled() const {
+        return m_fd >= 0;
+      }
+
+      std::size_t watch(const std::filesystem::path& file, std::function<void()> callback) {
+        auto token = ++m_next;
+
+        if (!enabled()) {
+          static_cast<void>(file);
+          static_cast<void>(callback);
+          return token;
+        }
+
+#ifdef TW_WATCH_INOTIFY
+        // editors often replace files instead of writing them, so the
+        // directory is watched rather than the file itself
+        auto path = std::filesystem::absolute(file);
+        auto parent = path.parent_path();
+        auto wd = ::inotify_add_watch(m_fd, parent.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+
+        if (wd < 0) {
+          return token;
+        }
+
+        auto& dir = m_directories[wd];
+        dir.path = parent;
+        dir.files[path.filename().string()].push_back(entry{.token = token, .callback = std::move(callback)});
+#endif
+
+        return token;
+      }
+
+      void unwatch(std::size_t token) {
+        for (auto dit = m_directories.begin(); dit != m_directories.end();) {
+          auto& files = dit->second.files;
+
+          for (auto fit = files.begin(); fit != files.end();) {
+            std::erase_if(fit->second, [token](const entry& e) { return e.token == token; });
+            fit = fit->second.empty() ? files.erase(fit) : std::next(fit);
+          }
+
+          if (files.empty()) {
+#ifdef TW_WATCH_INOTIFY
+            ::inotify_rm_watch(m_fd, dit->first);
+#endif
+            dit = m_directories.erase(dit);
+          }
+          else {
+            ++dit;
+          }
+        }
+      }
+
+      std::size_t size() const {
+        auto count = std::size_t{0};
+
+        for (auto& [wd, dir] : m_directories) {
+          for (auto& [name, entries] : dir.files) {
+            count += entries.size();
+          }
+        }
+
+        return count;
+      }
+
+      std::size_t poll() {
+        if (!enabled() || m_directories.empty()) {
+          return 0;
+        }
+
+        auto changed = std::vector<std::pair<int, std::string>>{};
+
+#ifdef TW_WATCH_INOTIFY
+        // a single read per frame, events that do not fit wait for the next one
+        alignas(inotify_event) auto buffer = std::array<char, 4096>{};
+        auto length = ::read(m_fd, buffer.data(), buffer.size());
+
+        for (auto offset = ssize_t{0}; offset < length;) {
+          auto* event = reinterpret_cast<const inotify_event*>(buffer.data() + offset);
+          offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+          if (event->len > 0) {
+            auto change = std::pair<int, std::string>{event->wd, event->name};
+
+            if (std::ranges::find(changed, change) == changed.end()) {
+              changed.push_back(std::move(change));
+            }
+          }
+        }
+#endif
+
+        auto count = std::size_t{0};
+
+        for (auto& [wd, name] : changed) {
+          auto dit = m_directories.find(wd);
+
+          if (dit == m_directories.end()) {
+            continue;
+          }
+
+          auto fit = dit->second.files.find(name);
+
+          if (fit == dit->second.files.end()) {
+            continue;
+          }
+
+          // callbacks may watch or unwatch files
+          auto callbacks = std::vector<std::function<void()>>{};
+
+          for (auto& e : fit->second) {
+            callbacks.push_back(e.callback);
+          }
+
+          for (auto& callback : callbacks) {
+            callback();
+            count++;
+          }
+        }
+
+        return count;
+      }
+
+    private:
+      int m_fd{-1};
+      std::size_t m_next{0};
+      std::map<int, directory> m_directories;
+  };
+}
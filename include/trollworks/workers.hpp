@@ -0,0 +1,84 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+#include <deque>
+#include <mutex>
+
+#include "../entt/entt.hpp"
+
+#include "./singleton.hpp"
+
+namespace tw {
+  class worker_pool {
+    public:
+      using task_type = std::function<void()>;
+
+      static worker_pool& main() {
+        return detail::singleton<worker_pool>();
+      }
+
+      explicit worker_pool(std::size_t count = std::max(std::thread::hardware_concurrency(), 2u)) {
+        m_threads.reserve(count);
+
+        for (auto i = std::size_t{0}; i < count; ++i) {
+          m_threads.emplace_back([this](std::stop_token token) { work(token); });
+        }
+      }
+
+      worker_pool(const worker_pool&) = delete;
+      worker_pool& operator=(const worker_pool&) = delete;
+
+      ~worker_pool() {
+        for (auto& thread : m_threads) {
+          thread.request_stop();
+        }
+
+        m_cv.notify_all();
+      }
+
+      void submit(task_type task) {
+        {
+          auto lock = std::scoped_lock{m_mutex};
+          m_tasks.push_back(std::move(task));
+        }
+
+        m_cv.notify_one();
+      }
+
+      std::size_t size() const {
+        return m_threads.size();
+      }
+
+    private:
+      void work(std::stop_token token) {
+        while (true) {
+          auto task = task_type{};
+
+          {
+            auto lock = std::unique_lock{m_mutex};
+            m_cv.wait(lock, token, [this]() { return !m_tasks.empty(); });
+
+            if (m_tasks.empty()) {
+              return;
+            }
+
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+          }
+
+          task();
+        }
+      }
+
+    private:
+      std::mutex m_mutex;
+      std::condition_variable_any m_cv;
+      std::deque<task_type> m_tasks;
+      std::vector<std::jthread> m_threads;
+  };
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+#include "../entt/entt.hpp"
+
+#include "./singleton.hpp"
+#include "./coroutine.hpp"
+#include "./messaging.hpp"
+#include "./rollback.hpp"
+#include "./mirror.hpp"
+#include "./scene.hpp"
+#include "./jobs.hpp"
+
+namespace tw {
+  class world {
+    private:
+      struct instances {
+        scene_manager scenes;
+        coroutine_manager coroutines;
+        job_manager jobs;
+        message_bus messages;
+      };
+
+    public:
+      static world& main() {
+        // worlds on different threads may be the first to ask for the instance
+        return detail::singleton<world>([]() {
+          entt::locator<world>::emplace(
+            scene_manager::main(),
+            coroutine_manager::main(),
+            job_manager::main(),
+            message_bus::main()
+          );
+        });
+      }
+
+      world()
+        : m_instances(std::make_unique<instances>()),
+          m_scenes(m_instances->scenes),
+          m_coroutines(m_instances->coroutines),
+          m_jobs(m_instances->jobs),
+          m_messages(m_instances->messages) {}
+
+      world(scene_manager& scenes, coroutine_manager& coroutines, job_manager& jobs, message_bus& messages)
+        : m_scenes(scenes), m_coroutines(coroutines), m_jobs(jobs), m_messages(messages) {}
+
+      world(const world&) = delete;
+      world& operator=(const world&) = delete;
+
+      scene_manager& scenes() {
+        return m_scenes;
+      }
+
+      entt::registry& registry() {
+        return m_scenes.registry();
+      }
+
+      coroutine_manager& coroutines() {
+        return m_coroutines;
+      }
+
+      job_manager& jobs() {
+        return m_jobs;
+      }
+
+      message_bus& messages() {
+        return m_messages;
+      }
+
+      template <typename... Components>
+      registry_mirror<Components...> mirror(std::size_t chunk_size = 1024) {
+        return registry_mirror<Components...>{m_scenes, chunk_size};
+      }
+
+      template <typename... Components>
+      rollback_buffer<Components...> rollback(std::size_t capacity = 16) {
+        return rollback_buffer<Components...>{m_scenes, capacity};
+      }
+
+      void update(float delta, void* data = nullptr) {
+        m_messages.update(dispatch_phase::before_fixed_update);
+        m_messages.update(dispatch_phase::after_update);
+        m_coroutines.update();
+        m_jobs.update(delta, data);
+        m_messages.update(dispatch_phase::before_render);
+        m_scenes.update();
+      }
+
+    private:
+      std::unique_ptr<instances> m_instances;
+      scene_manager& m_scenes;
+      coroutine_manager& m_coroutines;
+      job_manager& m_jobs;
+      message_bus& m_messages;
+  };
+}
@@ -0,0 +1,546 @@
+#include "doctest.h"
+
+#include <filesystem>
+#include <stdexcept>
+#include <iterator>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+#include <unistd.h>
+
+#include "../include/trollworks.hpp"
+
+using namespace entt::literals;
+
+static std::atomic<int> atlas_loads{0};
+
+struct texture_atlas {
+  std::string path;
+
+  using resource_type = texture_atlas;
+
+  struct loader_type final {
+    using result_type = std::shared_ptr<resource_type>;
+
+    result_type operator()(std::string path) const {
+      atlas_loads++;
+
+      if (path.empty()) {
+        throw std::runtime_error("missing atlas");
+      }
+
+      return std::make_shared<texture_atlas>(path);
+    }
+  };
+};
+
+struct atlas_listener {
+  int loaded{0};
+  int failed{0};
+
+  void on_loaded(tw::asset_loaded<texture_atlas>& e) {
+    if (e.handle.ready()) {
+      loaded++;
+    }
+    else if (e.handle.failed()) {
+      failed++;
+    }
+  }
+};
+
+template <typename Handle>
+static void wait_for(const Handle& handle) {
+  while (!handle.ready() && !handle.failed()) {
+    tw::asset_queue::main().update();
+    std::this_thread::yield();
+  }
+}
+
+TEST_CASE("asset manager async load") {
+  using assets = tw::asset_manager<texture_atlas>;
+
+  auto l = atlas_listener{};
+  tw::message_bus::main().sink<tw::asset_loaded<texture_atlas>>().connect<&atlas_listener::on_loaded>(l);
+
+  auto first = assets::load_async("tiles"_hs, std::string{"tiles.png"});
+  auto second = assets::load_async("tiles"_hs, std::string{"tiles.png"});
+  CHECK(assets::loading("tiles"_hs));
+
+  wait_for(first);
+  CHECK(second.ready());
+  CHECK(!assets::loading("tiles"_hs));
+  CHECK(atlas_loads == 1);
+  CHECK(first.resource()->path == "tiles.png");
+  CHECK(assets::cache().contains("tiles"_hs));
+
+  auto cached = assets::load_async("tiles"_hs, std::string{"tiles.png"});
+  CHECK(cached.ready());
+  CHECK(atlas_loads == 1);
+
+  // synchronous loads still go through the asset's loader
+  auto [it, loaded] = assets::cache().load("hud"_hs, std::string{"hud.png"});
+  CHECK(loaded);
+  CHECK(it->second->path == "hud.png");
+
+  auto broken = assets::load_async("broken"_hs, std::string{});
+  wait_for(broken);
+  CHECK(broken.failed());
+  CHECK_THROWS_AS(std::rethrow_exception(broken.error()), std::runtime_error);
+  CHECK(!assets::cache().contains("broken"_hs));
+
+  tw::message_bus::main().update();
+  CHECK(l.loaded == 1);
+  CHECK(l.failed == 1);
+
+  tw::message_bus::main().sink<tw::asset_loaded<texture_atlas>>().disconnect(&l);
+  assets::cache().clear();
+}
+
+struct numbered_asset {
+  int number;
+
+  using resource_type = numbered_asset;
+
+  // a loader with state, shared by every load of the asset type
+  struct loader_type {
+    using result_type = std::shared_ptr<resource_type>;
+
+    result_type operator()() {
+      return std::make_shared<numbered_asset>(++calls);
+    }
+
+    std::atomic<int> calls{0};
+  };
+};
+
+TEST_CASE("asset manager shares one loader") {
+  using assets = tw::asset_manager<numbered_asset>;
+
+  auto [it, loaded] = assets::cache().load("first"_hs);
+  CHECK(it->second->number == 1);
+
+  auto handle = assets::load_async("second"_hs);
+  wait_for(handle);
+  CHECK(handle.resource()->number == 2);
+  CHECK(assets::loader().calls == 2);
+
+  assets::cache().clear();
+}
+
+struct sound_clip {
+  std::size_t samples;
+
+  using resource_type = sound_clip;
+
+  struct loader_type {
+    using result_type = std::shared_ptr<resource_type>;
+
+    result_type operator()(std::size_t samples) const {
+      return std::make_shared<sound_clip>(samples);
+    }
+
+    std::size_t size(const sound_clip& clip) const {
+      return clip.samples * 2;
+    }
+  };
+};
+
+TEST_CASE("asset manager eviction") {
+  using clips = tw::asset_manager<sound_clip>;
+
+  clips::with_budget(1000);
+  clips::cache().load("a"_hs, std::size_t{100});
+  clips::cache().load("b"_hs, std::size_t{100});
+  clips::cache().load("c"_hs, std::size_t{100});
+
+  CHECK(clips::collect() == 0);
+  CHECK(clips::stats().used == 600);
+  CHECK(clips::stats().resident == 3);
+
+  auto held = clips::get("a"_hs);
+  clips::collect();
+  static_cast<void>(clips::get("b"_hs));
+  clips::collect();
+
+  // "c" is the least recently used, "a" is still referenced
+  clips::cache().load("d"_hs, std::size_t{300});
+  CHECK(clips::collect() == 1);
+  CHECK(!clips::cache().contains("c"_hs));
+  CHECK(clips::cache().contains("a"_hs));
+  CHECK(clips::stats().used == 1000);
+
+  clips::cache().load("e"_hs, std::size_t{200});
+  CHECK(clips::collect() == 2);
+  CHECK(clips::cache().contains("a"_hs));
+  CHECK(clips::stats().used <= 1000);
+  CHECK(clips::stats().evictions == 3);
+
+  // eviction also runs with the completion of asynchronous loads
+  held = {};
+  clips::cache().load("f"_hs, std::size_t{500});
+  tw::asset_queue::main().update();
+  CHECK(clips::stats().used <= 1000);
+  CHECK(clips::stats().evictions > 3);
+
+  // replaced resources are measured again
+  clips::cache().clear();
+  CHECK(clips::collect() == 0);
+  CHECK(clips::stats().used == 0);
+
+  held = clips::force_load("g"_hs, std::size_t{100});
+  CHECK(clips::stats().used == 200);
+  static_cast<void>(clips::force_load("g"_hs, std::size_t{400}));
+  CHECK(clips::stats().used == 800);
+
+  clips::with_budget(0);
+  clips::cache().load("h"_hs, std::size_t{1000});
+  CHECK(clips::collect() == 0);
+  CHECK(clips::cache().contains("h"_hs));
+  CHECK(clips::stats().resident == 2);
+
+  held = {};
+  clips::cache().clear();
+}
+
+struct shader_program {
+  std::string source;
+
+  using resource_type = shader_program;
+
+  struct loader_type {
+    using result_type = std::shared_ptr<resource_type>;
+
+    result_type operator()(std::string source) const {
+      return std::make_shared<shader_program>(source);
+    }
+
+    // shaders including another shader
+    result_type operator()(std::string source, entt::resource<shader_program> include) const {
+      return std::make_shared<shader_program>(include->source + source);
+    }
+
+    std::size_t size(const shader_program& shader) const {
+      return shader.source.size();
+    }
+  };
+};
+
+struct material {
+  std::string name;
+
+  using resource_type = material;
+
+  struct loader_type {
+    using result_type = std::shared_ptr<resource_type>;
+
+    result_type operator()(entt::resource<texture_atlas> atlas, entt::resource<shader_program> shader) const {
+      // dependencies are always loaded first
+      if (!atlas || !shader) {
+        throw std::logic_error("unresolved dependency");
+      }
+
+      return std::make_shared<material>(atlas->path + "+" + shader->source);
+    }
+  };
+};
+
+static void wait_for(const tw::asset_manifest& manifest) {
+  while (!manifest.progress().done()) {
+    tw::asset_queue::main().update();
+    std::this_thread::yield();
+  }
+}
+
+TEST_CASE("asset manifest preload") {
+  using atlases = tw::asset_manager<texture_atlas>;
+  using shaders = tw::asset_manager<shader_program>;
+  using materials = tw::asset_manager<material>;
+
+  SUBCASE("dependencies are resolved leaves first") {
+    auto manifest = tw::asset_manifest{};
+    manifest
+      .add<material>("grass"_hs, tw::asset_ref<texture_atlas>{"grass"_hs}, tw::asset_ref<shader_program>{"lit"_hs})
+      .add<shader_program>("lit"_hs, std::string{"lit"}, tw::asset_ref<shader_program>{"common"_hs})
+      .add<shader_program>("common"_hs, std::string{"common;"})
+      .add<texture_atlas>("grass"_hs, std::string{"grass.png"});
+
+    CHECK(manifest.progress().total == 0);
+
+    manifest.preload();
+    CHECK(manifest.progress().total == 4);
+    CHECK(manifest.progress().ratio() < 1.0f);
+
+    wait_for(manifest);
+    CHECK(manifest.progress().loaded == 4);
+    CHECK(manifest.progress().failed == 0);
+    CHECK(manifest.progress().ratio() == 1.0f);
+    CHECK(manifest.progress().bytes == std::string{"common;"}.size() + std::string{"common;lit"}.size() + sizeof(texture_atlas) + sizeof(material));
+    CHECK(manifest.errors().empty());
+
+    CHECK(materials::cache()["grass"_hs]->name == "grass.png+common;lit");
+    CHECK_THROWS_AS(manifest.preload(), std::logic_error);
+  }
+
+  SUBCASE("cached dependencies need not be declared") {
+    shaders::cache().load("lit"_hs, std::string{"cached"});
+
+    auto manifest = tw::asset_manifest{};
+    manifest
+      .add<texture_atlas>("grass"_hs, std::string{"grass.png"})
+      .add<material>("grass"_hs, tw::asset_ref<texture_atlas>{"grass"_hs}, tw::asset_ref<shader_program>{"lit"_hs})
+      .preload();
+
+    wait_for(manifest);
+    CHECK(manifest.progress().loaded == 2);
+    CHECK(materials::cache()["grass"_hs]->name == "grass.png+cached");
+  }
+
+  SUBCASE("dependencies are not evicted before their dependents start") {
+    atlases::cache().load("grass"_hs, std::string{"grass.png"});
+    atlases::with_budget(1);
+
+    auto manifest = tw::asset_manifest{};
+    manifest
+      .add<material>("grass"_hs, tw::asset_ref<texture_atlas>{"grass"_hs}, tw::asset_ref<shader_program>{"lit"_hs})
+      .add<shader_program>("lit"_hs, std::string{"lit"}, tw::asset_ref<shader_program>{"common"_hs})
+      .add<shader_program>("common"_hs, std::string{"common;"})
+      .preload();
+
+    wait_for(manifest);
+    CHECK(manifest.errors().empty());
+    CHECK(materials::cache()["grass"_hs]->name == "grass.png+common;lit");
+
+    atlases::with_budget(0);
+  }
+
+  SUBCASE("failures propagate to dependents") {
+    auto manifest = tw::asset_manifest{};
+    manifest
+      .add<texture_atlas>("broken"_hs, std::string{})
+      .add<shader_program>("lit"_hs, std::string{"lit"})
+      .add<material>("broken"_hs, tw::asset_ref<texture_atlas>{"broken"_hs}, tw::asset_ref<shader_program>{"lit"_hs})
+      .preload();
+
+    wait_for(manifest);
+    CHECK(manifest.progress().loaded == 1);
+    CHECK(manifest.progress().failed == 2);
+    CHECK(manifest.errors().size() == 2);
+    CHECK(!materials::cache().contains("broken"_hs));
+
+    for (auto& [id, exc] : manifest.errors()) {
+      CHECK_THROWS_WITH(std::rethrow_exception(exc), "missing atlas");
+    }
+  }
+
+  SUBCASE("invalid manifests are rejected") {
+    auto missing = tw::asset_manifest{};
+    missing.add<shader_program>("lit"_hs, std::string{"lit"}, tw::asset_ref<shader_program>{"common"_hs});
+    CHECK_THROWS_AS(missing.preload(), std::invalid_argument);
+
+    auto cyclic = tw::asset_manifest{};
+    cyclic
+      .add<shader_program>("a"_hs, std::string{"a"}, tw::asset_ref<shader_program>{"b"_hs})
+      .add<shader_program>("b"_hs, std::string{"b"}, tw::asset_ref<shader_program>{"a"_hs});
+    CHECK_THROWS_AS(cyclic.preload(), std::logic_error);
+
+    auto duplicate = tw::asset_manifest{};
+    duplicate
+      .add<shader_program>("a"_hs, std::string{"a"})
+      .add<shader_program>("a"_hs, std::string{"b"});
+    CHECK_THROWS_AS(duplicate.preload(), std::invalid_argument);
+  }
+
+  SUBCASE("rejected manifests can be preloaded again") {
+    atlases::cache().load("grass"_hs, std::string{"grass.png"});
+
+    auto manifest = tw::asset_manifest{};
+    manifest
+      .add<shader_program>("common"_hs, std::string{"common;"})
+      .add<material>("grass"_hs, tw::asset_ref<texture_atlas>{"grass"_hs}, tw::asset_ref<shader_program>{"lit"_hs});
+    CHECK_THROWS_AS(manifest.preload(), std::invalid_argument);
+    CHECK(manifest.progress().total == 0);
+
+    // the cached atlas is not held by the rejected manifest
+    CHECK(atlases::cache()["grass"_hs].handle().use_count() == 2);
+
+    shaders::cache().load("lit"_hs, std::string{"cached"});
+    manifest.preload();
+
+    wait_for(manifest);
+    CHECK(manifest.progress().loaded == 2);
+    CHECK(materials::cache()["grass"_hs]->name == "grass.png+cached");
+  }
+
+  atlases::cache().clear();
+  shaders::cache().clear();
+  materials::cache().clear();
+}
+
+static std::atomic<int> text_loads{0};
+
+struct text_file {
+  std::string text;
+
+  using resource_type = text_file;
+
+  struct loader_type {
+    using result_type = std::shared_ptr<resource_type>;
+
+    result_type operator()(std::filesystem::path path) const {
+      text_loads++;
+
+      auto in = std::ifstream{path};
+      auto text = std::string{std::istreambuf_iterator<char>{in}, {}};
+
+      if (text.empty()) {
+        throw std::runtime_error("empty file");
+      }
+
+      if (text == "null") {
+        return nullptr;
+      }
+
+      return std::make_shared<text_file>(text);
+    }
+  };
+};
+
+static std::atomic<bool> gate_open{false};
+
+struct gated_asset {
+  using resource_type = gated_asset;
+
+  struct loader_type {
+    using result_type = std::shared_ptr<resource_type>;
+
+    result_type operator()(entt::resource<text_file>) const {
+      while (!gate_open.load()) {
+        std::this_thread::yield();
+      }
+
+      return std::make_shared<gated_asset>();
+    }
+  };
+};
+
+struct reload_listener {
+  int reloaded{0};
+  int failed{0};
+
+  void on_reloaded(tw::asset_reloaded<text_file>& e) {
+    if (e.error) {
+      failed++;
+    }
+    else {
+      reloaded++;
+    }
+  }
+};
+
+TEST_CASE("asset hot reload") {
+  using texts = tw::asset_manager<text_file>;
+
+  if (!tw::file_watcher::main().enabled()) {
+    return;
+  }
+
+  auto root = std::filesystem::temp_directory_path() / ("trollworks-reload-" + std::to_string(::getpid()));
+  std::filesystem::create_directories(root);
+
+  auto write_file = [&](const char* name, const char* content) {
+    auto out = std::ofstream{root / name, std::ios::trunc};
+    out << content;
+  };
+
+  write_file("greeting.txt", "hello");
+  write_file("farewell.txt", "bye");
+
+  auto l = reload_listener{};
+  tw::message_bus::main().sink<tw::asset_reloaded<text_file>>().connect<&reload_listener::on_reloaded>(l);
+
+  texts::cache().load("greeting"_hs, root / "greeting.txt");
+  texts::cache().load("farewell"_hs, root / "farewell.txt");
+  texts::watch("greeting"_hs, root / "greeting.txt", root / "greeting.txt");
+  texts::watch("farewell"_hs, root / "farewell.txt", root / "farewell.txt");
+  CHECK(texts::watching("greeting"_hs));
+
+  auto greeting = texts::cache()["greeting"_hs];
+  auto loads = text_loads.load();
+
+  auto wait_for_reload = [&](int count) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+
+    while (l.reloaded + l.failed < count && std::chrono::steady_clock::now() < deadline) {
+      tw::asset_queue::main().update();
+      tw::message_bus::main().update();
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  };
+
+  write_file("greeting.txt", "hello, world");
+  wait_for_reload(1);
+
+  // existing handles see the new data, other assets are left alone
+  CHECK(l.reloaded == 1);
+  CHECK(greeting->text == "hello, world");
+  CHECK(texts::cache()["farewell"_hs]->text == "bye");
+  CHECK(text_loads == loads + 1);
+
+  // a failed reload keeps the previous data
+  write_file("greeting.txt", "");
+  wait_for_reload(2);
+  CHECK(l.failed == 1);
+  CHECK(greeting->text == "hello, world");
+
+  // a loader returning no resource fails too
+  write_file("greeting.txt", "null");
+  wait_for_reload(3);
+  CHECK(l.failed == 2);
+  CHECK(greeting->text == "hello, world");
+
+  // the resource is not assigned while a load may read it
+  auto gated = tw::asset_manager<gated_asset>::load_async("gated"_hs, greeting);
+  loads = text_loads.load();
+  write_file("greeting.txt", "hello again");
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (text_loads == loads && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  for (auto i = 0; i < 10; ++i) {
+    tw::asset_queue::main().update();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  CHECK(greeting->text == "hello, world");
+  CHECK(tw::asset_queue::main().in_flight() == 1);
+
+  // only the resources given to a load wait for it
+  write_file("farewell.txt", "see you");
+  wait_for_reload(4);
+  CHECK(l.reloaded == 2);
+  CHECK(texts::cache()["farewell"_hs]->text == "see you");
+  CHECK(greeting->text == "hello, world");
+
+  gate_open = true;
+  wait_for_reload(5);
+  CHECK(l.reloaded == 3);
+  CHECK(greeting->text == "hello again");
+
+  while (!gated.ready()) {
+    tw::asset_queue::main().update();
+  }
+
+  texts::unwatch("greeting"_hs);
+  texts::unwatch("farewell"_hs);
+  CHECK(!texts::watching("greeting"_hs));
+
+  tw::message_bus::main().sink<tw::asset_reloaded<text_file>>().disconnect(&l);
+  tw::asset_manager<gated_asset>::cache().clear();
+  texts::cache().clear();
+  std::filesystem::remove_all(root);
+}
@@ -0,0 +1,106 @@
+#include "doctest.h"
+
+#include <thread>
+#include <vector>
+
+#include "../include/trollworks.hpp"
+#include "../include/trollworks/fiber.hpp"
+
+void legacy_simulation(int& steps, int n) {
+  for (auto i = 0; i < n; ++i) {
+    steps++;
+    tw::this_fiber::yield();
+  }
+}
+
+TEST_CASE("fiber") {
+  auto steps = 0;
+  auto fib = tw::fiber{[&]() { legacy_simulation(steps, 3); }};
+
+  fib.resume();
+  CHECK(steps == 1);
+  CHECK(!fib.done());
+
+  while (!fib.done()) {
+    fib.resume();
+  }
+
+  CHECK(steps == 3);
+}
+
+TEST_CASE("fiber jobs") {
+  auto jobs = tw::job_manager{};
+  auto main_steps = 0;
+  auto worker_steps = 0;
+  auto continued = false;
+
+  jobs.attach<tw::fiber_job>([&]() { legacy_simulation(main_steps, 3); });
+  jobs.attach<tw::fiber_job>(
+    [&]() { legacy_simulation(worker_steps, 5); },
+    tw::fiber_affinity::worker
+  );
+  jobs
+    .attach<tw::fiber_job>([]() { throw std::runtime_error("boom"); })
+    .then([&](float, void*, auto succeed, auto) {
+      continued = true;
+      succeed();
+    });
+
+  jobs.update(0.0f);
+  CHECK(main_steps == 1);
+
+  while (!jobs.empty()) {
+    jobs.update(0.0f);
+  }
+
+  CHECK(main_steps == 3);
+  CHECK(worker_steps == 5);
+  CHECK(!continued);
+}
+
+TEST_CASE("destroying a suspended fiber unwinds its stack") {
+  struct guard {
+    bool& unwound;
+
+    ~guard() {
+      unwound = true;
+    }
+  };
+
+  auto unwound = false;
+  auto never = tw::fiber{[]() {}};
+
+  {
+    auto fib = tw::fiber{[&]() {
+      auto g = guard{unwound};
+
+      for (;;) {
+        tw::this_fiber::yield();
+      }
+    }};
+
+    fib.resume();
+    fib.resume();
+    CHECK(!unwound);
+  }
+
+  CHECK(unwound);
+}
+
+TEST_CASE("fibers migrate between threads") {
+  auto threads = std::vector<std::thread::id>{};
+  auto fib = tw::fiber{[&]() {
+    for (auto i = 0; i < 4; ++i) {
+      threads.push_back(std::this_thread::get_id());
+      CHECK(tw::fiber::current() != nullptr);
+      tw::this_fiber::yield();
+    }
+  }};
+
+  while (!fib.done()) {
+    std::thread{[&]() { fib.resume(); }}.join();
+  }
+
+  CHECK(threads.size() == 4);
+  CHECK(tw::fiber::current() == nullptr);
+}
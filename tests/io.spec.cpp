@@ -0,0 +1,69 @@
+#include "doctest.h"
+
+#include <filesystem>
+#include <string_view>
+#include <chrono>
+#include <thread>
+
+#include "../include/trollworks.hpp"
+
+struct io_listener {
+  int completed{0};
+
+  void on_completed(const tw::io_completed&) {
+    completed++;
+  }
+};
+
+TEST_CASE("io jobs") {
+  auto path = std::filesystem::temp_directory_path() / "trollworks-io.spec.bin";
+  auto text = std::string_view{"hello world"};
+  auto data = std::vector<std::byte>{
+    reinterpret_cast<const std::byte*>(text.data()),
+    reinterpret_cast<const std::byte*>(text.data() + text.size())
+  };
+
+  auto jobs = tw::job_manager{};
+  auto l = io_listener{};
+  auto result = std::shared_ptr<tw::io_request>{};
+
+  tw::message_bus::main().sink<tw::io_completed>().connect<&io_listener::on_completed>(l);
+
+  jobs
+    .attach<tw::io_job>(tw::io_service::main().write(path, data))
+    .then([&](float, void*, auto succeed, auto) {
+      result = tw::io_service::main().read(path);
+      succeed();
+    })
+    .then([&](float, void*, auto succeed, auto fail) {
+      if (!result->done()) {
+        return;
+      }
+
+      result->status() == tw::io_status::succeeded ? succeed() : fail();
+    });
+
+  while (!jobs.empty()) {
+    jobs.update(0.0f);
+  }
+
+  tw::message_bus::main().update();
+  tw::message_bus::main().sink<tw::io_completed>().disconnect<&io_listener::on_completed>(l);
+
+  CHECK(l.completed == 1);
+  REQUIRE(result->status() == tw::io_status::succeeded);
+  CHECK(result->buffer() == data);
+
+  auto missing = tw::io_service::main().read(path / "missing");
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+
+  while (!missing->done() && std::chrono::steady_clock::now() < deadline) {
+    tw::io_service::main().poll();
+    std::this_thread::yield();
+  }
+
+  CHECK(missing->status() == tw::io_status::failed);
+  CHECK(missing->error() != 0);
+
+  std::filesystem::remove(path);
+}
@@ -0,0 +1,88 @@
+#include "doctest.h"
+
+#include <thread>
+
+#include "../include/trollworks.hpp"
+
+struct counter : tw::job<counter> {
+  int& count;
+  int limit;
+  float& elapsed;
+
+  counter(int& count, int limit, float& elapsed)
+    : count(count), limit(limit), elapsed(elapsed) {}
+
+  void update(float delta, void*) {
+    elapsed += delta;
+
+    if (++count == limit) {
+      succeed();
+    }
+  }
+};
+
+TEST_CASE("job manager priorities") {
+  auto mgr = tw::job_manager{};
+  auto high = 0;
+  auto low = 0;
+  auto high_elapsed = 0.0f;
+  auto low_elapsed = 0.0f;
+
+  mgr.attach<counter>(high, 2, high_elapsed);
+  mgr.attach<counter>(tw::job_priority::low, low, 2, low_elapsed);
+
+  CHECK(mgr.pending(tw::job_priority::high) == 1);
+  CHECK(mgr.pending(tw::job_priority::low) == 1);
+
+  mgr.update(1.0f);
+  mgr.update(1.0f);
+
+  CHECK(high == 2);
+  CHECK(low == 2);
+  CHECK(mgr.empty());
+
+  auto normal = 0;
+  mgr
+    .attach(tw::job_priority::normal, [&](float, void*, auto succeed, auto) { normal++; succeed(); })
+    .attach<counter>(tw::job_priority::low, low, 3, low_elapsed);
+
+  mgr.update(1.0f);
+  CHECK(normal == 1);
+  CHECK(low == 3);
+  CHECK(mgr.empty());
+}
+
+struct sleeper : tw::job<sleeper> {
+  float& elapsed;
+
+  sleeper(float& elapsed) : elapsed(elapsed) {}
+
+  void update(float delta, void*) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    elapsed = delta;
+    succeed();
+  }
+};
+
+TEST_CASE("job manager budget") {
+  auto mgr = tw::job_manager{};
+  auto elapsed = std::array<float, 3>{};
+
+  mgr.with_budget(0.0001f);
+
+  for (auto& e : elapsed) {
+    mgr.attach<sleeper>(tw::job_priority::low, e);
+  }
+
+  mgr.update(1.0f);
+  CHECK(mgr.stats().ticked == 1);
+  CHECK(mgr.stats().deferred == 2);
+  CHECK(mgr.stats().deferred_time == 1.0f);
+  CHECK(mgr.pending(tw::job_priority::low) == 2);
+
+  mgr.update(1.0f);
+  mgr.update(1.0f);
+  CHECK(mgr.stats().deferred == 0);
+  CHECK(mgr.empty());
+  CHECK(elapsed == std::array<float, 3>{1.0f, 2.0f, 3.0f});
+}
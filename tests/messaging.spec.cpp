@@ -1,5 +1,14 @@
 #include "doctest.h"
 
+#include <thread>
+#include <vector>
+#include <span>
+#include <string>
+#include <string_view>
+#include <memory_resource>
+#include <sstream>
+#include <chrono>
+
 #include "../include/trollworks.hpp"
 
 struct an_event {
@@ -33,3 +42,382 @@ TEST_CASE("message bus") {
   bus.update();
   CHECK(w.value == 24);
 }
+
+struct produced_event {
+  int producer;
+  int seq;
+};
+
+struct ordering_listener {
+  std::vector<int> last;
+  int received{0};
+  bool ordered{true};
+
+  void on_event(const produced_event& e) {
+    ordered = ordered && e.seq == last[e.producer] + 1;
+    last[e.producer] = e.seq;
+    received++;
+  }
+};
+
+TEST_CASE("message bus posted from worker threads") {
+  constexpr auto producers = 4;
+  constexpr auto count = 1000;
+
+  auto bus = tw::message_bus{};
+  auto l = ordering_listener{.last = std::vector<int>(producers, -1)};
+  auto threads = std::vector<std::thread>{};
+
+  bus.sink<produced_event>().connect<&ordering_listener::on_event>(l);
+
+  for (auto p = 0; p < producers; ++p) {
+    threads.emplace_back([&bus, p]() {
+      for (auto i = 0; i < count; ++i) {
+        bus.post(produced_event{p, i});
+      }
+    });
+  }
+
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  CHECK(l.received == 0);
+  bus.update();
+  CHECK(l.received == producers * count);
+  CHECK(l.ordered);
+}
+
+TEST_CASE("message bus staging buffers are per bus") {
+  auto l = ordering_listener{.last = std::vector<int>(1, -1)};
+
+  for (auto round = 0; round < 3; ++round) {
+    // buses created at the same address must not share staged messages
+    auto bus = std::make_unique<tw::message_bus>();
+    bus->sink<produced_event>().connect<&ordering_listener::on_event>(l);
+
+    bus->post(produced_event{0, round});
+    std::thread{[&bus, round]() { bus->post(produced_event{0, round + 100}); }}.join();
+
+    if (round == 1) {
+      // pending messages are destroyed with the bus
+      continue;
+    }
+
+    bus->update();
+  }
+
+  CHECK(l.received == 4);
+}
+
+struct batch_listener {
+  std::size_t batches{0};
+  int sum{0};
+
+  void on_batch(std::span<const an_event> events) {
+    batches++;
+
+    for (auto& e : events) {
+      sum += e.value;
+    }
+  }
+};
+
+TEST_CASE("message bus batched delivery") {
+  auto bus = tw::message_bus{};
+  auto w = world{};
+  auto l = listener{w};
+  auto bl = batch_listener{};
+
+  bus.sink<an_event>().connect<&listener::on_event>(l);
+  bus.batch_sink<an_event>().connect<&batch_listener::on_batch>(bl);
+
+  for (auto i = 1; i <= 100; ++i) {
+    bus.enqueue(an_event{i});
+  }
+
+  CHECK(bus.size<an_event>() == 100);
+  bus.update();
+  CHECK(bus.size() == 0);
+  CHECK(bl.batches == 1);
+  CHECK(bl.sum == 5050);
+  CHECK(w.value == 100);
+
+  bus.trigger(an_event{1});
+  CHECK(bl.batches == 2);
+  CHECK(w.value == 1);
+
+  bus.disconnect(bl);
+  bus.enqueue(an_event{2});
+  bus.update();
+  CHECK(bl.batches == 2);
+  CHECK(w.value == 2);
+}
+
+class counting_resource : public std::pmr::memory_resource {
+  public:
+    std::size_t allocations{0};
+
+  private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+      allocations++;
+      return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+      std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+      return this == &other;
+    }
+};
+
+struct chat_message {
+  using allocator_type = std::pmr::polymorphic_allocator<>;
+
+  std::pmr::string text;
+
+  chat_message(std::string_view text, const allocator_type& alloc = {})
+    : text(text, alloc) {}
+
+  chat_message(const chat_message& other, const allocator_type& alloc = {})
+    : text(other.text, alloc) {}
+
+  chat_message(chat_message&& other, const allocator_type& alloc)
+    : text(std::move(other.text), alloc) {}
+};
+
+struct chat_listener {
+  std::size_t received{0};
+  bool in_arena{true};
+
+  void on_message(const chat_message& msg) {
+    received += msg.text.size();
+    in_arena = in_arena && msg.text.get_allocator().resource() != std::pmr::get_default_resource();
+  }
+};
+
+TEST_CASE("message bus frame arena") {
+  auto upstream = counting_resource{};
+  auto bus = tw::message_bus{};
+  auto l = chat_listener{};
+
+  bus.with_frame_arena(4096, &upstream);
+  bus.sink<chat_message>().connect<&chat_listener::on_message>(l);
+
+  auto frame = [&]() {
+    for (auto i = 0; i < 64; ++i) {
+      bus.enqueue<chat_message>("a message long enough to not fit in the SSO buffer");
+    }
+
+    bus.update();
+  };
+
+  frame();
+  frame();
+  auto allocations = upstream.allocations;
+
+  for (auto i = 0; i < 10; ++i) {
+    frame();
+  }
+
+  CHECK(upstream.allocations == allocations);
+  CHECK(l.received == 12 * 64 * 50);
+  CHECK(l.in_arena);
+
+  CHECK_THROWS_AS(bus.with_frame_arena(), std::logic_error);
+}
+
+TEST_CASE("frame arena alignment") {
+  auto arena = tw::frame_arena{1024};
+
+  for (auto alignment : {std::size_t{8}, std::size_t{64}, std::size_t{16}, std::size_t{256}, std::size_t{4}}) {
+    auto* ptr = arena.allocate(24, alignment);
+    CHECK(reinterpret_cast<std::uintptr_t>(ptr) % alignment == 0);
+  }
+
+  struct alignas(64) cache_line {
+    std::byte data[64];
+  };
+
+  auto lines = std::pmr::vector<cache_line>{&arena};
+  static_cast<void>(arena.allocate(1, 1));
+  lines.resize(3);
+  CHECK(reinterpret_cast<std::uintptr_t>(lines.data()) % 64 == 0);
+}
+
+struct health_changed {
+  int entity;
+  int value;
+};
+
+struct health_listener {
+  std::vector<health_changed> received;
+
+  void on_event(const health_changed& e) {
+    received.push_back(e);
+  }
+};
+
+TEST_CASE("message bus coalescing") {
+  auto bus = tw::message_bus{};
+  auto l = health_listener{};
+  auto key = [](const health_changed& e) { return e.entity; };
+
+  bus.sink<health_changed>().connect<&health_listener::on_event>(l);
+
+  auto frame = [&]() {
+    l.received.clear();
+    bus.enqueue(health_changed{1, 10});
+    bus.enqueue(health_changed{2, 20});
+    bus.enqueue(health_changed{1, 5});
+    bus.update();
+  };
+
+  bus.coalesce<health_changed>(key, tw::coalesce_policy::keep_last);
+  frame();
+  REQUIRE(l.received.size() == 2);
+  CHECK(l.received[0].value == 5);
+  CHECK(l.received[1].value == 20);
+
+  bus.coalesce<health_changed>(key, tw::coalesce_policy::keep_first);
+  frame();
+  REQUIRE(l.received.size() == 2);
+  CHECK(l.received[0].value == 10);
+
+  bus.coalesce<health_changed>(key, [](health_changed& existing, health_changed&& incoming) {
+    existing.value += incoming.value;
+  });
+  frame();
+  REQUIRE(l.received.size() == 2);
+  CHECK(l.received[0].value == 15);
+
+  CHECK_THROWS_AS(
+    bus.coalesce<health_changed>(key, tw::coalesce_policy::merge),
+    std::invalid_argument
+  );
+}
+
+struct slow_listener {
+  void on_event(const an_event&) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+};
+
+TEST_CASE("message bus statistics") {
+  auto bus = tw::message_bus{};
+  auto w = world{};
+  auto fast = listener{w};
+  auto slow = slow_listener{};
+
+  bus.with_stats();
+  bus.sink<an_event>().connect<&listener::on_event>(fast);
+  bus.sink<an_event>().connect<&slow_listener::on_event>(slow);
+
+  CHECK(bus.stats<health_changed>() == nullptr);
+
+  for (auto i = 0; i < 3; ++i) {
+    bus.enqueue(an_event{i});
+  }
+
+  bus.update();
+
+  auto* st = bus.stats<an_event>();
+  REQUIRE(st != nullptr);
+  CHECK(st->enqueued == 3);
+  CHECK(st->dispatched == 3);
+  CHECK(st->high_water == 3);
+  REQUIRE(st->listeners.size() == 2);
+  CHECK(st->listeners[1] >= 0.003f);
+  CHECK(st->listeners[0] < st->listeners[1]);
+  CHECK(st->duration >= st->listeners[1]);
+
+  bus.enqueue(an_event{42});
+  bus.update();
+  CHECK(st->enqueued == 1);
+  CHECK(st->high_water == 1);
+
+  auto trace = std::ostringstream{};
+  bus.write_trace(trace);
+  CHECK(trace.str().starts_with("[{"));
+  CHECK(trace.str().find("\"dispatched\":1") != std::string::npos);
+  CHECK(trace.str().find("\"name\":\"" + std::string{st->name} + "\"") != std::string::npos);
+
+  bus.with_stats(false);
+  CHECK(bus.stats<an_event>() == nullptr);
+  CHECK(bus.stats().empty());
+}
+
+struct input_event {};
+struct low_event {};
+
+struct phase_probe {
+  int stage{0};
+  int handled_at{-1};
+  std::vector<int> order;
+
+  void on_update(float, tw::controlflow&) {
+    stage = 1;
+    tw::message_bus::main().enqueue(input_event{});
+    tw::message_bus::main().enqueue(low_event{});
+  }
+
+  void on_late_update(float, tw::controlflow& cf) {
+    stage = 2;
+    cf = tw::controlflow::exit;
+  }
+
+  void on_input(const input_event&) {
+    handled_at = stage;
+    order.push_back(0);
+  }
+
+  void on_low(const low_event&) {
+    order.push_back(1);
+  }
+};
+
+TEST_CASE("message bus phase-targeted dispatch") {
+  auto& bus = tw::message_bus::main();
+  auto probe = phase_probe{};
+  auto loop = tw::game_loop{};
+
+  bus
+    .route<low_event>(tw::dispatch_phase::after_update, -1)
+    .route<input_event>(tw::dispatch_phase::after_update, 10);
+  bus.sink<input_event>().connect<&phase_probe::on_input>(probe);
+  bus.sink<low_event>().connect<&phase_probe::on_low>(probe);
+
+  loop
+    .on_update<&phase_probe::on_update>(probe)
+    .on_late_update<&phase_probe::on_late_update>(probe)
+    .run();
+
+  bus.disconnect(probe);
+
+  CHECK(probe.handled_at == 1);
+  CHECK(probe.order == std::vector<int>{0, 1});
+}
+
+TEST_CASE("message bus phases with frame arena") {
+  auto bus = tw::message_bus{};
+  auto w = world{};
+  auto l = listener{w};
+
+  bus.with_frame_arena(1024);
+  bus.route<an_event>(tw::dispatch_phase::before_fixed_update);
+  bus.sink<an_event>().connect<&listener::on_event>(l);
+
+  bus.update(tw::dispatch_phase::before_fixed_update);
+  bus.enqueue(an_event{1});
+  bus.update(tw::dispatch_phase::before_render);
+  CHECK(w.value == 0);
+
+  bus.enqueue(an_event{2});
+  bus.enqueue<health_changed>(3, 4);
+  bus.update(tw::dispatch_phase::before_render);
+  bus.update(tw::dispatch_phase::before_fixed_update);
+  CHECK(w.value == 2);
+  CHECK(bus.size() == 0);
+}
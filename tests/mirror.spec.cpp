@@ -0,0 +1,170 @@
+#include "doctest.h"
+
+#include <thread>
+#include <atomic>
+
+#include "../include/trollworks.hpp"
+
+struct transform {
+  int x;
+  int y;
+};
+
+struct health {
+  int value;
+};
+
+TEST_CASE("registry mirror") {
+  auto registry = entt::registry{};
+  auto mirror = tw::registry_mirror<transform, health>{registry, 4};
+
+  CHECK(mirror.acquire() == nullptr);
+
+  for (auto i = 0; i < 10; ++i) {
+    auto entity = registry.create();
+    registry.emplace<transform>(entity, i, i);
+
+    if (i % 2 == 0) {
+      registry.emplace<health>(entity, 100);
+    }
+  }
+
+  mirror.publish();
+
+  auto first = mirror.acquire();
+  REQUIRE(first != nullptr);
+  CHECK(first->number() == 1);
+  CHECK(first->entities<transform>().size() == 10);
+  CHECK(first->components<health>().size() == 5);
+
+  SUBCASE("frames held by readers are not modified") {
+    registry.patch<transform>(entt::entity{3}, [](auto& t) { t.x = 42; });
+    registry.destroy(entt::entity{0});
+    mirror.publish();
+
+    auto second = mirror.acquire();
+    CHECK(second->number() == 2);
+    CHECK(second->entities<transform>().size() == 9);
+    CHECK(first->entities<transform>().size() == 10);
+
+    auto found = false;
+    second->each<transform>([&](entt::entity entity, const transform& t) {
+      if (entity == entt::entity{3}) {
+        found = true;
+        CHECK(t.x == 42);
+      }
+    });
+    CHECK(found);
+
+    first->each<transform>([](entt::entity entity, const transform& t) {
+      CHECK(t.x == static_cast<int>(entt::to_entity(entity)));
+    });
+
+    CHECK(mirror.buffers() == 2);
+  }
+
+  SUBCASE("released frames are reused") {
+    first.reset();
+
+    for (auto i = 0; i < 5; ++i) {
+      registry.replace<health>(entt::entity{2}, i);
+      mirror.publish();
+    }
+
+    CHECK(mirror.buffers() == 2);
+
+    auto frame = mirror.acquire();
+    frame->each<health>([](entt::entity entity, const health& h) {
+      CHECK(h.value == (entity == entt::entity{2} ? 4 : 100));
+    });
+
+    // the other buffer is brought up to date with the changes of both frames
+    registry.replace<health>(entt::entity{4}, 7);
+    frame.reset();
+    mirror.publish();
+
+    auto latest = mirror.acquire();
+    latest->each<health>([](entt::entity entity, const health& h) {
+      if (entity == entt::entity{2}) {
+        CHECK(h.value == 4);
+      }
+      else {
+        CHECK(h.value == (entity == entt::entity{4} ? 7 : 100));
+      }
+    });
+  }
+
+  SUBCASE("sorted storages are mirrored") {
+    first.reset();
+    mirror.publish();
+
+    registry.sort<transform>([](const transform& lhs, const transform& rhs) { return lhs.x < rhs.x; });
+    mirror.publish();
+    CHECK(mirror.buffers() == 2);
+
+    auto frame = mirror.acquire();
+    CHECK(frame->components<transform>()[0].x == 9);
+    frame->each<transform>([](entt::entity entity, const transform& t) {
+      CHECK(t.x == static_cast<int>(entt::to_entity(entity)));
+    });
+  }
+
+  SUBCASE("readers on other threads") {
+    auto stop = std::atomic<bool>{false};
+    auto consistent = std::atomic<bool>{true};
+
+    auto reader = std::thread([&]() {
+      while (!stop.load()) {
+        if (auto frame = mirror.acquire(); frame != nullptr) {
+          frame->each<transform>([&](entt::entity, const transform& t) {
+            if (t.x != t.y) {
+              consistent = false;
+            }
+          });
+        }
+      }
+    });
+
+    for (auto i = 0; i < 200; ++i) {
+      for (auto [entity, t] : registry.view<transform>().each()) {
+        registry.replace<transform>(entity, i, i);
+      }
+
+      mirror.publish();
+    }
+
+    stop = true;
+    reader.join();
+    CHECK(consistent);
+  }
+}
+
+class transform_scene final : public tw::scene {
+  public:
+    virtual void load(entt::registry& registry) override {
+      registry.emplace<transform>(registry.create(), 1, 1);
+    }
+
+    virtual void unload(entt::registry&) override {}
+};
+
+TEST_CASE("registry mirror follows asynchronous scene loads") {
+  auto scenes = tw::scene_manager{};
+  auto mirror = tw::registry_mirror<transform>{scenes};
+
+  scenes.load(transform_scene{});
+  mirror.publish();
+
+  scenes.load_async(transform_scene{});
+  while (scenes.loading()) {
+    scenes.update();
+  }
+
+  mirror.publish();
+  CHECK(mirror.acquire()->entities<transform>().size() == 1);
+
+  // the storages of the new registry are listened to
+  scenes.registry().replace<transform>(scenes.registry().view<transform>().front(), 2, 2);
+  mirror.publish();
+  CHECK(mirror.acquire()->components<transform>()[0].x == 2);
+}
@@ -0,0 +1,134 @@
+#include "doctest.h"
+
+#include <filesystem>
+#include <fstream>
+#include <cstring>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "../include/trollworks.hpp"
+
+using namespace entt::literals;
+
+static std::vector<std::byte> bytes_of(std::string_view text) {
+  auto data = std::as_bytes(std::span{text.data(), text.size()});
+  return {data.begin(), data.end()};
+}
+
+TEST_CASE("pack archive") {
+  auto path = std::filesystem::temp_directory_path() / ("trollworks-" + std::to_string(::getpid()) + ".twpack");
+
+  auto large = std::vector<std::byte>(100000);
+
+  for (auto i = std::size_t{0}; i < large.size(); ++i) {
+    large[i] = static_cast<std::byte>(i % 251);
+  }
+
+  tw::pack_writer{}
+    .add("sprites/player.json", bytes_of("{\"frames\": 4}"))
+    .add("sounds/jump.wav", large)
+    .add("empty.txt", {})
+    .write(path);
+
+  SUBCASE("entries are viewed in place") {
+    auto pack = tw::pack_reader{path};
+    REQUIRE(pack.size() == 3);
+    CHECK(pack.contains("sprites/player.json"_hs));
+    CHECK(!pack.contains("missing"_hs));
+    CHECK(pack.name(1) == "sounds/jump.wav");
+
+    auto player = pack.view("sprites/player.json"_hs);
+    REQUIRE(player.has_value());
+    CHECK(std::ranges::equal(*player, bytes_of("{\"frames\": 4}")));
+
+    auto jump = pack.view("sounds/jump.wav"_hs);
+    REQUIRE(jump.has_value());
+    CHECK(std::ranges::equal(*jump, large));
+    CHECK(reinterpret_cast<std::uintptr_t>(jump->data()) % tw::pack_format::alignment == 0);
+
+    // views point in the mapping, no copy is made
+    CHECK(jump->data() == pack.view("sounds/jump.wav"_hs)->data());
+
+    CHECK(pack.view("empty.txt"_hs)->empty());
+    CHECK(!pack.view("missing"_hs).has_value());
+  }
+
+  SUBCASE("entries are read into a buffer") {
+    auto pack = tw::pack_reader{path};
+    CHECK(pack.read("sounds/jump.wav"_hs) == large);
+    CHECK_THROWS_AS(pack.read("missing"_hs), std::out_of_range);
+  }
+
+  SUBCASE("duplicate entries are rejected") {
+    auto writer = tw::pack_writer{};
+    writer.add("a", {});
+    CHECK_THROWS_AS(writer.add("a", {}), std::invalid_argument);
+  }
+
+  SUBCASE("compression requires a codec") {
+    auto writer = tw::pack_writer{};
+
+    if (tw::pack_writer::supports(tw::pack_compression::lz4)) {
+      writer.add("large", large, tw::pack_compression::lz4).write(path);
+
+      auto pack = tw::pack_reader{path};
+      CHECK(!pack.view("large"_hs).has_value());
+      CHECK(pack.read("large"_hs) == large);
+    }
+    else {
+      CHECK_THROWS_AS(writer.add("large", large, tw::pack_compression::lz4), std::invalid_argument);
+    }
+  }
+
+  SUBCASE("invalid files are rejected") {
+    {
+      auto out = std::ofstream{path, std::ios::binary | std::ios::trunc};
+      out << "not a pack, definitely not a pack";
+    }
+
+    CHECK_THROWS_AS(tw::pack_reader{path}, std::runtime_error);
+  }
+
+  SUBCASE("corrupted indexes are rejected") {
+    auto original = std::vector<char>(std::filesystem::file_size(path));
+    std::ifstream{path, std::ios::binary}.read(original.data(), static_cast<std::streamsize>(original.size()));
+
+    auto header = tw::pack_format::header{};
+    std::memcpy(&header, original.data(), sizeof(header));
+
+    auto corrupt = [&](std::size_t position, auto value) {
+      auto data = original;
+      std::memcpy(data.data() + position, &value, sizeof(value));
+      std::ofstream{path, std::ios::binary | std::ios::trunc}.write(data.data(), static_cast<std::streamsize>(data.size()));
+    };
+
+    // the second entry, "sounds/jump.wav"
+    auto entry = header.index_offset + sizeof(tw::pack_format::entry);
+
+    corrupt(offsetof(tw::pack_format::header, index_offset), std::uint64_t{original.size() + 64});
+    CHECK_THROWS_AS(tw::pack_reader{path}, std::runtime_error);
+
+    corrupt(offsetof(tw::pack_format::header, count), std::uint32_t{1000000});
+    CHECK_THROWS_AS(tw::pack_reader{path}, std::runtime_error);
+
+    corrupt(entry + offsetof(tw::pack_format::entry, offset), std::uint64_t{original.size()});
+    CHECK_THROWS_AS(tw::pack_reader{path}, std::runtime_error);
+
+    corrupt(entry + offsetof(tw::pack_format::entry, stored_size), std::uint64_t{header.index_offset});
+    CHECK_THROWS_AS(tw::pack_reader{path}, std::runtime_error);
+
+    corrupt(entry + offsetof(tw::pack_format::entry, size), std::uint64_t{200000});
+    CHECK_THROWS_AS(tw::pack_reader{path}, std::runtime_error);
+
+    corrupt(entry + offsetof(tw::pack_format::entry, name_size), std::uint32_t{4096});
+    CHECK_THROWS_AS(tw::pack_reader{path}, std::runtime_error);
+
+    corrupt(0, header);
+    CHECK(tw::pack_reader{path}.read("sounds/jump.wav"_hs) == large);
+  }
+
+  std::filesystem::remove(path);
+}
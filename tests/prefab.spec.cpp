@@ -0,0 +1,64 @@
+#include "doctest.h"
+
+#include <array>
+
+#include "../include/trollworks.hpp"
+
+struct projectile {
+  float speed;
+  int damage;
+};
+
+struct lifetime {
+  float seconds;
+};
+
+struct hostile {};
+
+struct spawn_listener {
+  int batches{0};
+  std::size_t entities{0};
+
+  void on_instantiate(entt::registry&, const tw::prefab&, std::span<const entt::entity> spawned) {
+    batches++;
+    entities += spawned.size();
+  }
+};
+
+TEST_CASE("prefab instantiation") {
+  auto bullet = tw::prefab{};
+  bullet
+    .with(projectile{.speed = 10.0f, .damage = 1})
+    .with(lifetime{.seconds = 2.0f})
+    .with<hostile>()
+    .with(projectile{.speed = 20.0f, .damage = 5});
+
+  CHECK(bullet.size() == 3);
+  CHECK(bullet.contains(entt::type_hash<hostile>::value()));
+
+  SUBCASE("in a registry") {
+    auto registry = entt::registry{};
+    auto entities = std::array<entt::entity, 16>{};
+    bullet.instantiate(registry, entities.begin(), entities.end());
+
+    CHECK(registry.storage<projectile>().size() == 16);
+    CHECK(registry.storage<hostile>().size() == 16);
+
+    for (auto entity : entities) {
+      CHECK(registry.get<projectile>(entity).damage == 5);
+      CHECK(registry.get<lifetime>(entity).seconds == 2.0f);
+    }
+  }
+
+  SUBCASE("through the scene manager") {
+    auto mgr = tw::scene_manager{};
+    auto l = spawn_listener{};
+    mgr.on_instantiate().connect<&spawn_listener::on_instantiate>(l);
+
+    auto entities = mgr.instantiate(bullet, 10000);
+    CHECK(entities.size() == 10000);
+    CHECK(l.batches == 1);
+    CHECK(l.entities == 10000);
+    CHECK(mgr.registry().view<projectile, lifetime, hostile>().size_hint() == 10000);
+  }
+}
@@ -0,0 +1,130 @@
+#include "doctest.h"
+
+#include "../include/trollworks.hpp"
+
+struct body {
+  int x;
+  int vx;
+};
+
+struct stunned {
+  int frames;
+};
+
+static void simulate(entt::registry& registry, int tick) {
+  for (auto [entity, b] : registry.view<body>().each()) {
+    registry.patch<body>(entity, [](auto& b) { b.x += b.vx; });
+  }
+
+  if (tick == 3) {
+    registry.emplace<stunned>(entt::entity{1}, 2);
+    registry.destroy(entt::entity{2});
+  }
+
+  if (tick == 5) {
+    registry.emplace<body>(registry.create(), 100, 1);
+    registry.remove<stunned>(entt::entity{1});
+  }
+}
+
+static std::vector<int> positions(entt::registry& registry) {
+  auto result = std::vector<int>{};
+
+  for (auto [entity, b] : registry.view<body>().each()) {
+    result.push_back(b.x);
+  }
+
+  std::ranges::sort(result);
+  return result;
+}
+
+TEST_CASE("rollback buffer") {
+  auto registry = entt::registry{};
+  auto rollback = tw::rollback_buffer<body, stunned>{registry, 8};
+
+  for (auto i = 0; i < 4; ++i) {
+    registry.emplace<body>(registry.create(), i * 10, i);
+  }
+
+  rollback.commit(0);
+
+  auto states = std::vector<std::vector<int>>{positions(registry)};
+
+  for (auto tick = 1; tick <= 6; ++tick) {
+    simulate(registry, tick);
+    rollback.commit(tick);
+    states.push_back(positions(registry));
+  }
+
+  CHECK(rollback.oldest() == 0);
+  CHECK(rollback.latest() == 6);
+  CHECK(rollback.changes(6) == 4);
+
+  SUBCASE("restore and resimulate") {
+    // uncommitted changes are discarded too
+    registry.patch<body>(entt::entity{0}, [](auto& b) { b.x = -1; });
+
+    CHECK(rollback.restore(2));
+    CHECK(rollback.latest() == 2);
+    CHECK(positions(registry) == states[2]);
+    CHECK(registry.valid(entt::entity{2}));
+    CHECK(!registry.all_of<stunned>(entt::entity{1}));
+    CHECK(registry.storage<entt::entity>().free_list() == 4);
+
+    for (auto tick = 3; tick <= 6; ++tick) {
+      simulate(registry, tick);
+      rollback.commit(tick);
+      CHECK(positions(registry) == states[tick]);
+    }
+
+    CHECK(rollback.restore(4));
+    CHECK(positions(registry) == states[4]);
+    CHECK(registry.get<stunned>(entt::entity{1}).frames == 2);
+  }
+
+  SUBCASE("history is bounded") {
+    for (auto tick = 7; tick <= 12; ++tick) {
+      simulate(registry, tick);
+      rollback.commit(tick);
+    }
+
+    CHECK(rollback.oldest() == 4);
+    CHECK(!rollback.restore(3));
+    CHECK(rollback.restore(4));
+    CHECK(positions(registry) == states[4]);
+  }
+}
+
+class body_scene final : public tw::scene {
+  public:
+    virtual void load(entt::registry& registry) override {
+      registry.emplace<body>(registry.create(), 0, 1);
+    }
+
+    virtual void unload(entt::registry&) override {}
+};
+
+TEST_CASE("rollback buffer follows asynchronous scene loads") {
+  auto scenes = tw::scene_manager{};
+  auto rollback = tw::rollback_buffer<body>{scenes, 4};
+
+  scenes.load(body_scene{});
+  rollback.commit(0);
+  simulate(scenes.registry(), 1);
+  rollback.commit(1);
+
+  scenes.load_async(body_scene{});
+  while (scenes.loading()) {
+    scenes.update();
+  }
+
+  // the history of the previous registry is dropped
+  CHECK(!rollback.restore(0));
+
+  rollback.commit(2);
+  scenes.registry().patch<body>(scenes.registry().view<body>().front(), [](auto& b) { b.x = 42; });
+  rollback.commit(3);
+  CHECK(rollback.changes(3) == 1);
+  CHECK(rollback.restore(2));
+  CHECK(positions(scenes.registry()) == std::vector<int>{0});
+}
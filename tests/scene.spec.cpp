@@ -1,5 +1,7 @@
 #include "doctest.h"
 
+#include <sstream>
+
 #include "../include/trollworks.hpp"
 
 struct world {
@@ -35,3 +37,326 @@ TEST_CASE("scene manager") {
   CHECK(w.unloaded == 42);
   CHECK(w.loaded == 24);
 }
+
+struct tile {
+  int value;
+};
+
+class big_scene final : public tw::scene {
+  public:
+    big_scene(int count) : m_count(count) {}
+
+    virtual void load(entt::registry& registry) override {
+      auto& progress = registry.ctx().get<tw::scene_progress>();
+
+      for (auto i = 0; i < m_count; ++i) {
+        registry.emplace<tile>(registry.create(), i);
+        progress.report(static_cast<float>(i) / m_count);
+      }
+    }
+
+    virtual void unload(entt::registry&) override {}
+
+  private:
+    int m_count;
+};
+
+class broken_scene final : public tw::scene {
+  public:
+    virtual void load(entt::registry&) override {
+      throw std::runtime_error("missing level file");
+    }
+
+    virtual void unload(entt::registry&) override {}
+};
+
+struct swap_listener {
+  std::size_t swaps{0};
+
+  void on_swap(entt::registry&) {
+    swaps++;
+  }
+};
+
+TEST_CASE("scene manager async load") {
+  auto mgr = tw::scene_manager{};
+  auto w = world{};
+  auto l = swap_listener{};
+  mgr.registry().ctx().emplace<world&>(w);
+  mgr.on_swap().connect<&swap_listener::on_swap>(l);
+
+  mgr.load(scene{42});
+  mgr.load_async(big_scene{1000});
+  CHECK(mgr.loading());
+  CHECK_THROWS_AS(mgr.load_async(big_scene{1}), std::logic_error);
+  CHECK_THROWS_AS(mgr.load(scene{1}), std::logic_error);
+
+  while (mgr.loading()) {
+    mgr.update();
+  }
+
+  CHECK(l.swaps == 1);
+  CHECK(mgr.progress() == 1.0f);
+  CHECK(w.unloaded == 42);
+  CHECK(mgr.registry().storage<tile>().size() == 1000);
+  CHECK(mgr.registry().ctx().contains<world&>());
+
+  mgr.load_async(broken_scene{});
+
+  auto thrown = false;
+  while (mgr.loading()) {
+    try {
+      mgr.update();
+    }
+    catch (const std::runtime_error&) {
+      thrown = true;
+    }
+  }
+
+  CHECK(thrown);
+  CHECK(l.swaps == 1);
+  CHECK(mgr.registry().storage<tile>().size() == 1000);
+}
+
+struct hud_widget {};
+struct sublevel_prop {};
+
+template <typename Tag>
+class tagged_scene final : public tw::scene {
+  public:
+    tagged_scene(int count, int& unloaded) : m_count(count), m_unloaded(unloaded) {}
+
+    virtual void load(entt::registry& registry) override {
+      for (auto i = 0; i < m_count; ++i) {
+        registry.emplace<Tag>(registry.create());
+      }
+    }
+
+    virtual void unload(entt::registry&) override {
+      m_unloaded++;
+    }
+
+  private:
+    int m_count;
+    int& m_unloaded;
+};
+
+TEST_CASE("scene manager additive scenes") {
+  auto mgr = tw::scene_manager{};
+  auto unloaded = 0;
+
+  auto hud = mgr.load_additive(tagged_scene<hud_widget>{3, unloaded});
+  auto sublevel = mgr.load_additive(tagged_scene<sublevel_prop>{10, unloaded});
+  CHECK(hud != sublevel);
+  CHECK(mgr.members(hud).size() == 3);
+  CHECK(mgr.members(sublevel).size() == 10);
+
+  auto spawned = mgr.registry().create();
+  mgr.registry().emplace<sublevel_prop>(spawned);
+  mgr.adopt(sublevel, spawned);
+  CHECK(mgr.members(sublevel).size() == 11);
+
+  // an entity moves to the scene adopting it, and leaves it once destroyed
+  mgr.adopt(hud, spawned);
+  CHECK(mgr.members(sublevel).size() == 10);
+  CHECK(mgr.members(hud).contains(spawned));
+
+  auto extra = mgr.registry().create();
+  mgr.adopt(hud, extra);
+  mgr.registry().destroy(extra);
+  CHECK(mgr.members(hud).size() == 4);
+
+  mgr.disown(hud, spawned);
+  CHECK(mgr.members(hud).size() == 3);
+  CHECK(!mgr.member(hud, spawned));
+
+  mgr.adopt(sublevel, spawned);
+  CHECK_THROWS_AS(mgr.members(sublevel + 1), std::invalid_argument);
+
+  mgr.unload(sublevel);
+  CHECK(unloaded == 1);
+  CHECK(!mgr.contains(sublevel));
+  CHECK(mgr.contains(hud));
+  CHECK(mgr.registry().storage<sublevel_prop>().empty());
+  CHECK(mgr.registry().storage<hud_widget>().size() == 3);
+  CHECK_THROWS_AS(mgr.unload(sublevel), std::invalid_argument);
+
+  mgr.registry().ctx().emplace<tw::scene_progress>();
+  mgr.load(big_scene{10});
+  CHECK(mgr.registry().storage<tile>().size() == 10);
+  CHECK(mgr.registry().storage<hud_widget>().size() == 3);
+  CHECK(mgr.members(hud).size() == 3);
+  CHECK(unloaded == 1);
+
+  // handles are not storages, the registry does not grow with each scene
+  for (auto i = 0; i < 10; ++i) {
+    mgr.unload(mgr.load_additive(tagged_scene<sublevel_prop>{1, unloaded}));
+  }
+
+  auto storages = std::ranges::distance(mgr.registry().storage());
+  mgr.unload(mgr.load_additive(tagged_scene<sublevel_prop>{1, unloaded}));
+  CHECK(std::ranges::distance(mgr.registry().storage()) == storages);
+  CHECK(mgr.members(hud).size() == 3);
+}
+
+struct score {
+  int value;
+};
+
+class hud_scene final : public tw::scene {
+  public:
+    virtual void load(entt::registry& registry) override {
+      registry.emplace<score>(registry.create(), m_score);
+    }
+
+    virtual void unload(entt::registry& registry) override {
+      for (auto [entity, s] : registry.view<score>().each()) {
+        m_score = s.value;
+      }
+    }
+
+  private:
+    int m_score{0};
+};
+
+TEST_CASE("scene manager additive scenes and asynchronous loads") {
+  auto mgr = tw::scene_manager{};
+  auto hud = mgr.load_additive(hud_scene{});
+
+  auto entity = *mgr.members(hud).begin();
+  mgr.registry().replace<score>(entity, 42);
+
+  // the entities cannot follow the registry swap
+  CHECK_THROWS_AS(mgr.load_async(big_scene{10}), std::logic_error);
+  CHECK(!mgr.loading());
+
+  mgr.registry().ctx().emplace<tw::scene_progress>();
+  mgr.load(big_scene{10});
+  REQUIRE(mgr.members(hud).size() == 1);
+  CHECK(mgr.registry().get<score>(entity).value == 42);
+
+  mgr.unload(hud);
+  mgr.load_async(big_scene{10});
+  CHECK_THROWS_AS(mgr.load_additive(hud_scene{}), std::logic_error);
+
+  while (mgr.loading()) {
+    mgr.update();
+  }
+
+  hud = mgr.load_additive(hud_scene{});
+  CHECK(mgr.members(hud).size() == 1);
+  CHECK(mgr.registry().storage<score>().size() == 1);
+}
+
+struct teardown_listener {
+  std::size_t batches{0};
+  std::size_t tiles{0};
+  std::size_t widgets{0};
+
+  void on_teardown(entt::registry&, entt::sparse_set& storage) {
+    batches++;
+
+    if (storage.type() == entt::type_id<tile>()) {
+      tiles += storage.size();
+    }
+    else if (storage.type() == entt::type_id<hud_widget>()) {
+      widgets += storage.size();
+    }
+  }
+};
+
+TEST_CASE("scene manager bulk teardown") {
+  auto mgr = tw::scene_manager{};
+  auto l = teardown_listener{};
+  auto unloaded = 0;
+
+  mgr.registry().ctx().emplace<tw::scene_progress>();
+  mgr.on_teardown().connect<&teardown_listener::on_teardown>(l);
+
+  auto hud = mgr.load_additive(tagged_scene<hud_widget>{2, unloaded});
+
+  mgr.load(big_scene{1000});
+  auto capacity = mgr.registry().storage<tile>().capacity();
+  CHECK(mgr.registry().storage<tile>().size() == 1000);
+
+  // a storage shared by the scene and the HUD
+  mgr.registry().emplace<hud_widget>(mgr.registry().create());
+  auto alive = mgr.registry().storage<entt::entity>().free_list();
+
+  mgr.load(big_scene{10}, tw::scene_teardown::bulk);
+  CHECK(l.tiles == 1000);
+  CHECK(l.widgets == 1);
+  CHECK(l.batches == 2);
+  CHECK(mgr.registry().storage<tile>().size() == 10);
+  CHECK(mgr.registry().storage<tile>().capacity() == capacity);
+  CHECK(mgr.registry().storage<entt::entity>().free_list() == alive - 1001 + 10);
+
+  CHECK(unloaded == 0);
+  CHECK(mgr.contains(hud));
+  CHECK(mgr.registry().storage<hud_widget>().size() == 2);
+  CHECK(mgr.members(hud).size() == 2);
+}
+
+class manifest_scene final : public tw::scene {
+  public:
+    static void capacity(tw::scene_capacity& capacity) {
+      capacity
+        .entities(4096)
+        .reserve<tile>(4096);
+    }
+
+    virtual void load(entt::registry& registry) override {
+      registry.emplace<tile>(registry.create(), 0);
+    }
+
+    virtual void unload(entt::registry&) override {}
+};
+
+TEST_CASE("scene manager capacity hints") {
+  auto mgr = tw::scene_manager{};
+
+  SUBCASE("static manifest") {
+    mgr.load(manifest_scene{});
+    CHECK(mgr.registry().storage<tile>().size() == 1);
+    CHECK(mgr.registry().storage<tile>().capacity() >= 4096);
+    CHECK(mgr.registry().storage<entt::entity>().capacity() >= 4096);
+  }
+
+  SUBCASE("recorded profile") {
+    auto unloaded = 0;
+    mgr.registry().ctx().emplace<tw::scene_progress>();
+    auto hud = mgr.load_additive(tagged_scene<hud_widget>{3, unloaded});
+    mgr.load(big_scene{5000});
+
+    // the entities of the additive scene are not part of the profile
+    CHECK(mgr.capacity<big_scene>().count(entt::type_hash<tile>::value()) == 5000);
+    CHECK(mgr.capacity<big_scene>().count(entt::type_hash<hud_widget>::value()) == 0);
+    CHECK(mgr.capacity<big_scene>().count(entt::type_hash<tw::scene_member>::value()) == 0);
+    CHECK(mgr.capacity<big_scene>().entities() == 5000);
+
+    // a storage declared by any profile of the manager can be created from its
+    // identifier, loaded in a fresh registry it is reserved up front
+    static_cast<void>(mgr.capacity<manifest_scene>());
+    mgr.unload(hud);
+    mgr.load_async(big_scene{10});
+    while (mgr.loading()) {
+      mgr.update();
+    }
+
+    CHECK(mgr.registry().storage<tile>().size() == 10);
+    CHECK(mgr.registry().storage<tile>().capacity() >= 5000);
+  }
+
+  SUBCASE("persisted profile") {
+    auto profile = tw::scene_capacity{};
+    profile.entities(128).reserve<tile>(64);
+
+    auto buffer = std::stringstream{};
+    profile.write(buffer);
+
+    auto restored = tw::scene_capacity{};
+    restored.read(buffer);
+    CHECK(restored.entities() == 128);
+    CHECK(restored.count(entt::type_hash<tile>::value()) == 64);
+  }
+}
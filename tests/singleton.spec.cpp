@@ -0,0 +1,61 @@
+#include "doctest.h"
+
+#include <thread>
+#include <vector>
+
+#include "../include/trollworks/singleton.hpp"
+
+struct service {
+  int value{0};
+};
+
+struct configured_service {
+  int value;
+};
+
+TEST_CASE("singletons are provided again after a reset") {
+  auto& first = tw::detail::singleton<service>();
+  first.value = 42;
+  CHECK(&tw::detail::singleton<service>() == &first);
+  CHECK(tw::detail::singleton<service>().value == 42);
+
+  entt::locator<service>::reset();
+  CHECK(!entt::locator<service>::has_value());
+  CHECK(tw::detail::singleton<service>().value == 0);
+  CHECK(entt::locator<service>::has_value());
+
+  auto calls = 0;
+  auto init = [&calls]() {
+    calls++;
+    entt::locator<configured_service>::emplace(7);
+  };
+
+  CHECK(tw::detail::singleton<configured_service>(init).value == 7);
+  CHECK(tw::detail::singleton<configured_service>(init).value == 7);
+  CHECK(calls == 1);
+
+  entt::locator<configured_service>::reset();
+  CHECK(tw::detail::singleton<configured_service>(init).value == 7);
+  CHECK(calls == 2);
+}
+
+TEST_CASE("singletons are created once across threads") {
+  struct shared_service {};
+
+  auto threads = std::vector<std::thread>{};
+  auto instances = std::vector<shared_service*>(8);
+
+  for (auto i = std::size_t{0}; i < instances.size(); ++i) {
+    threads.emplace_back([&instances, i]() {
+      instances[i] = &tw::detail::singleton<shared_service>();
+    });
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (auto* instance : instances) {
+    CHECK(instance == instances.front());
+  }
+}
@@ -0,0 +1,115 @@
+#include "doctest.h"
+
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <string>
+
+#include <cstddef>
+#include <cstdint>
+
+#include <unistd.h>
+
+#include "../include/trollworks.hpp"
+
+struct position {
+  float x;
+  float y;
+};
+
+struct frozen {};
+
+TEST_CASE("snapshot round trip") {
+  auto path = std::filesystem::temp_directory_path() / ("trollworks-" + std::to_string(::getpid()) + ".twsnap");
+
+  auto source = entt::registry{};
+
+  for (auto i = 0; i < 1000; ++i) {
+    auto entity = source.create();
+    source.emplace<position>(entity, static_cast<float>(i), static_cast<float>(-i));
+
+    if (i % 3 == 0) {
+      source.emplace<frozen>(entity);
+    }
+  }
+
+  auto removed = entt::entity{42};
+  source.destroy(removed);
+
+  tw::snapshot_writer{source}
+    .save<position>()
+    .save<frozen>()
+    .write(path);
+
+  SUBCASE("components are restored") {
+    auto dest = entt::registry{};
+    tw::snapshot_reader{path, dest}
+      .load<position>()
+      .load<frozen>();
+
+    CHECK(dest.storage<entt::entity>().free_list() == source.storage<entt::entity>().free_list());
+    CHECK(!dest.valid(removed));
+    CHECK(dest.storage<position>().size() == 999);
+    CHECK(dest.storage<frozen>().size() == source.storage<frozen>().size());
+
+    for (auto [entity, pos] : source.view<position>().each()) {
+      REQUIRE(dest.all_of<position>(entity));
+      CHECK(dest.get<position>(entity).x == pos.x);
+      CHECK(dest.get<position>(entity).y == pos.y);
+      CHECK(dest.all_of<frozen>(entity) == source.all_of<frozen>(entity));
+    }
+
+    // recycled identifiers keep their version
+    auto recycled = dest.create();
+    CHECK(entt::to_entity(recycled) == entt::to_entity(removed));
+    CHECK(entt::to_version(recycled) == entt::to_version(source.create()));
+  }
+
+  SUBCASE("components can be skipped") {
+    auto dest = entt::registry{};
+    tw::snapshot_reader{path, dest}.load<position>();
+
+    CHECK(dest.storage<position>().size() == 999);
+    CHECK(dest.storage<frozen>().empty());
+  }
+
+  SUBCASE("layout mismatch is detected") {
+    auto dest = entt::registry{};
+    auto reader = tw::snapshot_reader{path, dest};
+
+    struct position3d { float x, y, z; };
+    CHECK_THROWS_AS(reader.load<position3d>(entt::type_hash<position>::value()), std::runtime_error);
+  }
+
+  SUBCASE("loading requires an empty registry") {
+    auto dest = entt::registry{};
+    static_cast<void>(dest.create());
+    CHECK_THROWS_AS((tw::snapshot_reader{path, dest}), std::logic_error);
+  }
+
+  SUBCASE("corrupted sections are rejected") {
+    auto size = std::uint64_t{0};
+    auto offset = offsetof(tw::snapshot_format::section_header, size) + tw::snapshot_format::alignment;
+
+    {
+      auto in = std::ifstream{path, std::ios::binary};
+      in.seekg(static_cast<std::streamoff>(offset));
+      in.read(reinterpret_cast<char*>(&size), sizeof(size));
+    }
+
+    // a size wrapping around the end of the address space, then one that is
+    // not a multiple of the alignment
+    for (auto corrupted : {std::numeric_limits<std::uint64_t>::max() - 63, size - 1}) {
+      {
+        auto out = std::fstream{path, std::ios::binary | std::ios::in | std::ios::out};
+        out.seekp(static_cast<std::streamoff>(offset));
+        out.write(reinterpret_cast<const char*>(&corrupted), sizeof(corrupted));
+      }
+
+      auto dest = entt::registry{};
+      CHECK_THROWS_AS((tw::snapshot_reader{path, dest}), std::runtime_error);
+    }
+  }
+
+  std::filesystem::remove(path);
+}
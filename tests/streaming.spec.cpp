@@ -0,0 +1,183 @@
+#include "doctest.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <vector>
+
+#include <unistd.h>
+
+#include "../include/trollworks.hpp"
+
+struct terrain {
+  tw::cell_coord cell;
+};
+
+class empty_scene final : public tw::scene {
+  public:
+    virtual void load(entt::registry&) override {}
+    virtual void unload(entt::registry&) override {}
+};
+
+static void wait_for(tw::cell_streamer& streamer) {
+  do {
+    streamer.update();
+    std::this_thread::yield();
+  }
+  while (streamer.pending() > 0);
+}
+
+TEST_CASE("cell streaming") {
+  auto dir = std::filesystem::temp_directory_path() / ("trollworks-cells-" + std::to_string(::getpid()));
+  std::filesystem::create_directories(dir);
+
+  auto path = [dir](tw::cell_coord cell) {
+    return dir / (std::to_string(cell.x) + "_" + std::to_string(cell.y) + ".chunk");
+  };
+
+  // only the cells of the first row exist, with 4 entities each
+  for (auto x = 0; x < 4; ++x) {
+    auto out = std::ofstream{path({x, 0}), std::ios::binary};
+    out << "abcd";
+  }
+
+  auto scenes = tw::scene_manager{};
+  auto decode = [](tw::cell_coord cell, std::span<const std::byte> data, entt::registry& registry) {
+    for (auto i = std::size_t{0}; i < data.size(); ++i) {
+      registry.emplace<terrain>(registry.create(), cell);
+    }
+  };
+
+  auto config = tw::streaming_config{
+    .cell_size = 10.0f,
+    .load_radius = 0,
+    .unload_radius = 1,
+    .memory_budget = 1024
+  };
+
+  SUBCASE("cells follow the focus with hysteresis") {
+    auto streamer = tw::cell_streamer{config, path, decode, scenes};
+    auto focus = streamer.add_focus(5.0f, 5.0f);
+    wait_for(streamer);
+
+    CHECK(streamer.loaded({0, 0}));
+    CHECK(streamer.memory() == 4);
+    CHECK(scenes.registry().storage<terrain>().size() == 4);
+
+    streamer.move_focus(focus, 15.0f, 5.0f);
+    wait_for(streamer);
+    CHECK(streamer.loaded({1, 0}));
+    CHECK(streamer.loaded({0, 0}));
+
+    streamer.move_focus(focus, 25.0f, 5.0f);
+    wait_for(streamer);
+    CHECK(streamer.loaded({2, 0}));
+    CHECK(streamer.loaded({1, 0}));
+    CHECK(!streamer.loaded({0, 0}));
+    CHECK(scenes.registry().storage<terrain>().size() == 8);
+
+    // missing chunks are empty cells
+    streamer.move_focus(focus, 25.0f, 15.0f);
+    wait_for(streamer);
+    CHECK(streamer.loaded({2, 1}));
+    CHECK(!streamer.handle({2, 1}));
+  }
+
+  SUBCASE("memory budget evicts the farthest cells") {
+    config.unload_radius = 3;
+    config.memory_budget = 8;
+
+    auto streamer = tw::cell_streamer{config, path, decode, scenes};
+    auto focus = streamer.add_focus(5.0f, 5.0f);
+    wait_for(streamer);
+
+    streamer.move_focus(focus, 15.0f, 5.0f);
+    wait_for(streamer);
+    CHECK(streamer.memory() == 8);
+
+    streamer.move_focus(focus, 25.0f, 5.0f);
+    wait_for(streamer);
+    CHECK(streamer.memory() == 8);
+    CHECK(!streamer.loaded({0, 0}));
+    CHECK(streamer.loaded({1, 0}));
+    CHECK(streamer.loaded({2, 0}));
+  }
+
+  SUBCASE("entities are relocated between cells") {
+    config.load_radius = 1;
+    config.unload_radius = 1;
+
+    auto streamer = tw::cell_streamer{config, path, decode, scenes};
+    auto focus = streamer.add_focus(15.0f, 5.0f);
+    wait_for(streamer);
+
+    auto entity = *scenes.members(*streamer.handle({0, 0})).begin();
+    CHECK(streamer.relocate(entity, 25.0f, 5.0f));
+    CHECK(!streamer.relocate(entity, 100.0f, 5.0f));
+    CHECK(scenes.member(*streamer.handle({2, 0}), entity));
+    CHECK(!scenes.member(*streamer.handle({0, 0}), entity));
+
+    streamer.move_focus(focus, 35.0f, 5.0f);
+    wait_for(streamer);
+    CHECK(!streamer.loaded({0, 0}));
+    CHECK(scenes.registry().valid(entity));
+  }
+
+  SUBCASE("cells wait for asynchronous scene loads") {
+    auto streamer = tw::cell_streamer{config, path, decode, scenes};
+    scenes.load_async(empty_scene{});
+    streamer.add_focus(5.0f, 5.0f);
+
+    for (auto i = 0; i < 100; ++i) {
+      streamer.update();
+      std::this_thread::yield();
+    }
+
+    CHECK(scenes.registry().storage<terrain>().empty());
+
+    while (scenes.loading()) {
+      scenes.update();
+    }
+
+    wait_for(streamer);
+    CHECK(scenes.registry().storage<terrain>().size() == 4);
+  }
+
+  SUBCASE("chunks are inflated on workers, and installed over several frames") {
+    config.load_radius = 1;
+    config.installs_per_frame = 1;
+
+    auto main_thread = std::this_thread::get_id();
+    auto on_worker = std::atomic<bool>{true};
+
+    auto streamer = tw::cell_streamer{config, path, decode, scenes};
+    streamer.inflate([&](tw::cell_coord, std::vector<std::byte> data) {
+      on_worker = on_worker && std::this_thread::get_id() != main_thread;
+      auto inflated = data;
+      inflated.insert(inflated.end(), data.begin(), data.end());
+      return inflated;
+    });
+
+    streamer.add_focus(5.0f, 5.0f);
+
+    do {
+      auto before = scenes.registry().storage<terrain>().size();
+      streamer.update();
+      CHECK(scenes.registry().storage<terrain>().size() - before <= 8);
+      std::this_thread::yield();
+    }
+    while (streamer.pending() > 0);
+
+    CHECK(on_worker);
+    CHECK(streamer.loaded({0, 0}));
+    CHECK(streamer.loaded({1, 0}));
+
+    // the budget counts the inflated chunks
+    CHECK(streamer.memory() == 16);
+    CHECK(scenes.registry().storage<terrain>().size() == 16);
+  }
+
+  std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,129 @@
+#include "doctest.h"
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include <cstdint>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "../include/trollworks.hpp"
+#include "../include/trollworks/transport.hpp"
+
+struct frame_stats {
+  int frame;
+  float duration;
+};
+
+// another layout of the same message, as built by an older publisher
+struct wide_stats {
+  int frame;
+  float duration;
+  std::array<std::byte, 64> padding;
+};
+
+template <>
+struct entt::type_hash<wide_stats> {
+  static constexpr entt::id_type value() noexcept {
+    return entt::type_hash<frame_stats>::value();
+  }
+
+  constexpr operator entt::id_type() const noexcept {
+    return value();
+  }
+};
+
+struct stats_listener {
+  std::vector<int> frames;
+
+  void on_stats(const frame_stats& e) {
+    frames.push_back(e.frame);
+  }
+};
+
+TEST_CASE("shared memory transport") {
+  auto name = "/trollworks-test-" + std::to_string(::getpid());
+  auto producer = tw::message_bus{};
+  auto consumer = tw::message_bus{};
+  auto l = stats_listener{};
+
+  auto publisher = tw::shm_publisher{name, 256};
+  auto subscriber = tw::shm_subscriber{name};
+
+  publisher.mirror<frame_stats>(producer);
+  subscriber.forward<frame_stats>(consumer);
+  consumer.sink<frame_stats>().connect<&stats_listener::on_stats>(l);
+
+  for (auto frame = 0; frame < 20; ++frame) {
+    producer.enqueue(frame_stats{frame, 0.016f});
+    producer.update();
+
+    subscriber.update();
+    consumer.update();
+  }
+
+  CHECK(subscriber.overruns() == 0);
+  REQUIRE(l.frames.size() == 20);
+  CHECK(l.frames.back() == 19);
+
+  for (auto frame = 0; frame < 100; ++frame) {
+    producer.enqueue(frame_stats{frame, 0.016f});
+  }
+
+  producer.update();
+  subscriber.update();
+  CHECK(subscriber.overruns() == 1);
+
+  producer.trigger(frame_stats{42, 0.0f});
+  CHECK(subscriber.update() == 1);
+  consumer.update();
+  CHECK(l.frames.back() == 42);
+}
+
+TEST_CASE("shared memory transport skips mismatched records") {
+  auto name = "/trollworks-test-mismatch-" + std::to_string(::getpid());
+  auto producer = tw::message_bus{};
+  auto consumer = tw::message_bus{};
+
+  auto publisher = tw::shm_publisher{name, 256};
+  auto subscriber = tw::shm_subscriber{name};
+
+  publisher.mirror<frame_stats>(producer);
+  subscriber.forward<wide_stats>(consumer);
+
+  producer.trigger(frame_stats{1, 0.016f});
+  CHECK(subscriber.update() == 1);
+  CHECK(subscriber.mismatches() == 1);
+  CHECK(subscriber.overruns() == 0);
+  CHECK(consumer.size<wide_stats>() == 0);
+}
+
+TEST_CASE("shared memory transport validates rings") {
+  auto name = "/trollworks-test-validate-" + std::to_string(::getpid());
+
+  {
+    auto publisher = tw::shm_publisher{name, 256};
+    CHECK_THROWS_AS(tw::shm_publisher(name, 256), std::runtime_error);
+    CHECK_NOTHROW(tw::shm_subscriber{name});
+  }
+
+  // a header announcing more capacity than the segment holds
+  auto fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  REQUIRE(fd >= 0);
+  REQUIRE(::ftruncate(fd, 4096) == 0);
+
+  auto* addr = ::mmap(nullptr, 4096, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  REQUIRE(addr != MAP_FAILED);
+
+  auto header = std::array<std::uint64_t, 2>{0x74772d73686d3031, 1 << 20};
+  std::memcpy(addr, header.data(), sizeof(header));
+  ::munmap(addr, 4096);
+
+  CHECK_THROWS_AS(tw::shm_subscriber{name}, std::runtime_error);
+  ::shm_unlink(name.c_str());
+}
@@ -0,0 +1,82 @@
+#include "doctest.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <chrono>
+#include <thread>
+
+#include <unistd.h>
+
+#include "../include/trollworks.hpp"
+
+namespace fs = std::filesystem;
+
+static void write_file(const fs::path& path, const std::string& content) {
+  auto out = std::ofstream{path, std::ios::trunc};
+  out << content;
+}
+
+TEST_CASE("file watcher") {
+  auto watcher = tw::file_watcher{};
+
+  if (!watcher.enabled()) {
+    return;
+  }
+
+  auto root = fs::temp_directory_path() / ("trollworks-watch-" + std::to_string(::getpid()));
+  fs::create_directories(root);
+  write_file(root / "a.txt", "a");
+  write_file(root / "b.txt", "b");
+
+  auto a_changes = 0;
+  auto b_changes = 0;
+  auto a = watcher.watch(root / "a.txt", [&]() { a_changes++; });
+  watcher.watch(root / "b.txt", [&]() { b_changes++; });
+  CHECK(watcher.size() == 2);
+
+  // nothing changed
+  CHECK(watcher.poll() == 0);
+
+  write_file(root / "a.txt", "a2");
+  write_file(root / "a.txt", "a3");
+  write_file(root / "other.txt", "other");
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+
+  while (a_changes == 0 && std::chrono::steady_clock::now() < deadline) {
+    watcher.poll();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  // both writes are coalesced when read in the same poll
+  CHECK(a_changes >= 1);
+  CHECK(a_changes <= 2);
+  CHECK(b_changes == 0);
+
+  SUBCASE("files replaced by a rename are seen") {
+    auto before = b_changes;
+    write_file(root / "b.tmp", "b2");
+    fs::rename(root / "b.tmp", root / "b.txt");
+
+    while (b_changes == before && std::chrono::steady_clock::now() < deadline) {
+      watcher.poll();
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    CHECK(b_changes == before + 1);
+  }
+
+  SUBCASE("unwatched files are ignored") {
+    auto before = a_changes;
+    watcher.unwatch(a);
+    CHECK(watcher.size() == 1);
+
+    write_file(root / "a.txt", "a4");
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    watcher.poll();
+    CHECK(a_changes == before);
+  }
+
+  fs::remove_all(root);
+}
@@ -0,0 +1,104 @@
+#include "doctest.h"
+
+#include <thread>
+#include <vector>
+
+#include "../include/trollworks.hpp"
+
+struct score {
+  int points;
+};
+
+struct match {
+  tw::world world;
+  int frames{0};
+  int scored{0};
+
+  void on_update(float, tw::controlflow& cf) {
+    world.registry().emplace<score>(world.registry().create(), frames);
+    world.messages().enqueue(score{.points = 1});
+
+    if (++frames == 10) {
+      cf = tw::controlflow::exit;
+    }
+  }
+
+  void on_score(score& e) {
+    scored += e.points;
+  }
+};
+
+TEST_CASE("independent worlds") {
+  CHECK(&tw::world::main().scenes() == &tw::scene_manager::main());
+  CHECK(&tw::world::main().messages() == &tw::message_bus::main());
+
+  auto matches = std::vector<std::unique_ptr<match>>{};
+
+  for (auto i = 0; i < 8; ++i) {
+    auto& m = matches.emplace_back(std::make_unique<match>());
+    m->world.messages().sink<score>().connect<&match::on_score>(*m);
+  }
+
+  {
+    auto threads = std::vector<std::jthread>{};
+
+    for (auto& m : matches) {
+      threads.emplace_back([&m = *m]() {
+        auto loop = tw::game_loop{};
+        loop
+          .with_world(m.world)
+          .on_update<&match::on_update>(m)
+          .run();
+      });
+    }
+  }
+
+  for (auto& m : matches) {
+    CHECK(m->frames == 10);
+    CHECK(m->scored == 10);
+    CHECK(m->world.registry().storage<score>().size() == 10);
+  }
+
+  CHECK(tw::scene_manager::main().registry().storage<score>().empty());
+}
+
+struct position {
+  int x;
+};
+
+TEST_CASE("world mirrors and rollbacks") {
+  auto w = tw::world{};
+  auto mirror = w.mirror<position>();
+  auto rollback = w.rollback<position>(4);
+
+  auto entity = w.registry().create();
+  w.registry().emplace<position>(entity, 1);
+  rollback.commit(0);
+  mirror.publish();
+
+  CHECK(mirror.acquire()->components<position>().size() == 1);
+  CHECK(tw::scene_manager::main().registry().storage<position>().empty());
+
+  w.registry().replace<position>(entity, 2);
+  rollback.commit(1);
+  CHECK(rollback.restore(0));
+  CHECK(w.registry().get<position>(entity).x == 1);
+}
+
+TEST_CASE("singletons are created once across threads") {
+  auto pools = std::vector<tw::worker_pool*>(4, nullptr);
+
+  {
+    auto threads = std::vector<std::jthread>{};
+
+    for (auto& pool : pools) {
+      threads.emplace_back([&pool]() {
+        pool = &tw::worker_pool::main();
+      });
+    }
+  }
+
+  for (auto pool : pools) {
+    CHECK(pool == &tw::worker_pool::main());
+  }
+}
@@ -0,0 +1,101 @@
+#include <filesystem>
+#include <iostream>
+#include <fstream>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <span>
+
+#include <unistd.h>
+
+#include "../include/trollworks/pack.hpp"
+
+namespace fs = std::filesystem;
+using clock_type = std::chrono::steady_clock;
+
+static constexpr auto file_count = 2000;
+static constexpr auto file_size = 16 * 1024;
+
+template <typename F>
+static double measure(F&& f) {
+  auto start = clock_type::now();
+  f();
+  return std::chrono::duration<double, std::milli>(clock_type::now() - start).count();
+}
+
+// every byte is read on both sides, mapped pages are only loaded when touched,
+// and the same code sums them for every measure
+[[gnu::noinline]] static std::size_t touch(std::span<const std::byte> data) {
+  auto sum = std::size_t{0};
+
+  for (auto b : data) {
+    sum += static_cast<std::size_t>(b);
+  }
+
+  return sum;
+}
+
+int main() {
+  auto root = fs::temp_directory_path() / ("trollworks-pack-bench-" + std::to_string(::getpid()));
+  auto archive = root / "assets.twpack";
+  auto names = std::vector<std::string>{};
+  auto writer = tw::pack_writer{};
+
+  fs::create_directories(root / "loose");
+
+  auto data = std::vector<char>(file_size);
+
+  for (auto i = 0; i < file_count; ++i) {
+    std::ranges::fill(data, static_cast<char>(i));
+
+    auto name = "asset-" + std::to_string(i) + ".bin";
+    auto out = std::ofstream{root / "loose" / name, std::ios::binary};
+    out.write(data.data(), static_cast<std::streamsize>(data.size()));
+
+    writer.add(name, std::as_bytes(std::span{data}));
+    names.push_back(name);
+  }
+
+  writer.write(archive);
+
+  // the writeback of the files written above would run during the measures
+  ::sync();
+
+  auto checksum = std::size_t{0};
+
+  auto loose = measure([&] {
+    for (auto& name : names) {
+      auto path = root / "loose" / name;
+      auto in = std::ifstream{path, std::ios::binary};
+      auto buffer = std::vector<std::byte>(fs::file_size(path));
+      in.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+      checksum += touch(buffer);
+    }
+  });
+
+  auto packed = measure([&] {
+    auto pack = tw::pack_reader{archive};
+
+    for (auto& name : names) {
+      checksum += touch(*pack.view(entt::hashed_string::value(name.c_str(), name.size())));
+    }
+  });
+
+  auto copied = measure([&] {
+    auto pack = tw::pack_reader{archive};
+
+    for (auto& name : names) {
+      checksum += touch(pack.read(entt::hashed_string::value(name.c_str(), name.size())));
+    }
+  });
+
+  std::cout << file_count << " assets of " << file_size << " bytes" << std::endl;
+  std::cout << "  loose files:  " << loose << " ms" << std::endl;
+  std::cout << "  pack (view):  " << packed << " ms" << std::endl;
+  std::cout << "  pack (read):  " << copied << " ms" << std::endl;
+  std::cout << "  checksum:     " << checksum << std::endl;
+
+  fs::remove_all(root);
+  return 0;
+}
@@ -0,0 +1,74 @@
+#include <filesystem>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "../include/trollworks/pack.hpp"
+
+namespace fs = std::filesystem;
+
+static int usage() {
+  std::cerr << "usage: trollworks-packer [--lz4|--zstd] <output.twpack> <directory>" << std::endl;
+  return 1;
+}
+
+int main(int argc, char** argv) {
+  auto args = std::vector<std::string>(argv + 1, argv + argc);
+  auto compression = tw::pack_compression::none;
+
+  if (!args.empty() && args.front() == "--lz4") {
+    compression = tw::pack_compression::lz4;
+    args.erase(args.begin());
+  }
+  else if (!args.empty() && args.front() == "--zstd") {
+    compression = tw::pack_compression::zstd;
+    args.erase(args.begin());
+  }
+
+  if (args.size() != 2) {
+    return usage();
+  }
+
+  if (!tw::pack_writer::supports(compression)) {
+    std::cerr << "compression not available, rebuild with TW_WITH_LZ4 or TW_WITH_ZSTD" << std::endl;
+    return 1;
+  }
+
+  auto output = fs::path{args[0]};
+  auto root = fs::path{args[1]};
+  auto files = std::vector<fs::path>{};
+
+  for (auto& entry : fs::recursive_directory_iterator{root}) {
+    if (entry.is_regular_file()) {
+      files.push_back(entry.path());
+    }
+  }
+
+  // deterministic archives regardless of the directory order
+  std::ranges::sort(files);
+
+  auto writer = tw::pack_writer{};
+
+  try {
+    for (auto& file : files) {
+      auto in = std::ifstream{file, std::ios::binary};
+      auto data = std::vector<char>{std::istreambuf_iterator<char>{in}, {}};
+      auto name = fs::relative(file, root).generic_string();
+
+      writer.add(name, std::as_bytes(std::span{data}), compression);
+      std::cout << "  PACK    " << name << " (" << data.size() << " bytes)" << std::endl;
+    }
+
+    writer.write(output);
+  }
+  catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  std::cout << "  WROTE   " << output.string() << " (" << files.size() << " entries)" << std::endl;
+  return 0;
+}